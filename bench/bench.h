@@ -0,0 +1,150 @@
+#ifndef LIB_CHRON_BENCH_H
+#define LIB_CHRON_BENCH_H
+
+#include "libchron.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+/* Helpers shared by the benchmarks. Every benchmark prints one JSON object
+per result line to stdout, so runs can be diffed and tracked across versions. */
+
+/**
+ * @brief Get the current CLOCK_MONOTONIC time in ns
+ *
+ * @return uint64_t
+ */
+static inline uint64_t bench_now_ns(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * CHRON_NS_PER_S + now.tv_nsec;
+}
+
+/**
+ * @brief Get the CPU time consumed by the whole process so far, in ns
+ *
+ * @return uint64_t
+ */
+static inline uint64_t bench_cpu_ns(void) {
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+
+	return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * CHRON_NS_PER_S +
+		(uint64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * CHRON_NS_PER_US;
+}
+
+/**
+ * @brief Read a positive integer parameter from the environment
+ *
+ * @param name
+ * @param fallback returned if the variable is unset or invalid
+ * @return long
+ */
+static inline long bench_param(const char* name, long fallback) {
+	const char* value = getenv(name);
+	long n = value ? atol(value) : 0;
+
+	return n > 0 ? n : fallback;
+}
+
+/**
+ * @brief Get the number of online CPUs
+ *
+ * @return int
+ */
+static inline int bench_n_cpus(void) {
+	long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return n_cpus > 0 ? (int)n_cpus : 1;
+}
+
+/**
+ * @brief Comparator for sorting samples in ascending order
+ */
+static inline int bench_cmp_u64(const void* a, const void* b) {
+	uint64_t x = *(const uint64_t*)a;
+	uint64_t y = *(const uint64_t*)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief Summary of a set of latency samples, in ns
+ */
+typedef struct bench_summary {
+	uint64_t min;
+
+	uint64_t p50;
+
+	uint64_t p99;
+
+	uint64_t p999;
+
+	uint64_t max;
+
+	double mean;
+
+	/* standard deviation; our measure of jitter */
+	double stddev;
+} bench_summary_t;
+
+/**
+ * @brief Summarize `n` samples. The samples are sorted in place.
+ *
+ * @param samples
+ * @param n
+ * @param summary
+ */
+static inline void bench_summarize(uint64_t* samples, long n, bench_summary_t* summary) {
+	double sum = 0;
+	double sq_sum = 0;
+
+	memset(summary, 0, sizeof(bench_summary_t));
+
+	if (n <= 0) return;
+
+	qsort(samples, n, sizeof(uint64_t), bench_cmp_u64);
+
+	for (long i = 0; i < n; i++) sum += samples[i];
+
+	summary->mean = sum / n;
+
+	for (long i = 0; i < n; i++) {
+		sq_sum += (samples[i] - summary->mean) * (samples[i] - summary->mean);
+	}
+
+	summary->stddev = n > 1 ? sqrt(sq_sum / (n - 1)) : 0;
+
+	summary->min = samples[0];
+	summary->p50 = samples[n / 2];
+	summary->p99 = samples[(long)(n * 0.99)];
+	summary->p999 = samples[(long)(n * 0.999)];
+	summary->max = samples[n - 1];
+}
+
+/**
+ * @brief Print a summary as the JSON fields of a result line, without braces
+ *
+ * @param prefix
+ * @param summary
+ */
+static inline void bench_print_summary(const char* prefix, const bench_summary_t* summary) {
+	printf(
+		"\"%s_min_ns\":%lu,\"%s_p50_ns\":%lu,\"%s_p99_ns\":%lu,\"%s_p999_ns\":%lu,"
+		"\"%s_max_ns\":%lu,\"%s_mean_ns\":%.0f,\"%s_stddev_ns\":%.0f",
+		prefix, summary->min,
+		prefix, summary->p50,
+		prefix, summary->p99,
+		prefix, summary->p999,
+		prefix, summary->max,
+		prefix, summary->mean,
+		prefix, summary->stddev
+	);
+}
+
+#endif /* LIB_CHRON_BENCH_H */
@@ -0,0 +1,135 @@
+#include "bench.h"
+
+/**
+ * Per-expiry overhead of chron_timer_t on each backend: the CPU time the
+ * whole process spends per delivered expiration, and how late expirations
+ * are delivered relative to the timer's period.
+ *
+ * Parameters (environment):
+ *   CHRON_BENCH_TIMERS       number of concurrent periodic timers (default 100)
+ *   CHRON_BENCH_INTERVAL_MS  period of each timer, in ms (default 10)
+ *   CHRON_BENCH_DURATION_MS  length of each run, in ms (default 2000)
+ */
+
+typedef struct timer_ctx {
+	/* CLOCK_MONOTONIC time at which the timer was started, in ns */
+	uint64_t start_ns;
+
+	uint64_t interval_ns;
+
+	/* expirations seen so far */
+	uint64_t n;
+
+	/* one lateness sample per expiration, up to `capacity` */
+	uint64_t* samples;
+
+	long capacity;
+} timer_ctx_t;
+
+static atomic_long n_expirations;
+
+static void on_expiry(chron_timer_t* timer, void* arg) {
+	timer_ctx_t* ctx = (timer_ctx_t*)arg;
+	uint64_t now = bench_now_ns();
+	uint64_t due;
+
+	(void)timer;
+
+	// the timer was deleted while this expiration was in flight
+	if (!ctx) return;
+
+	due = ctx->start_ns + ++ctx->n * ctx->interval_ns;
+
+	if ((long)ctx->n <= ctx->capacity) {
+		ctx->samples[ctx->n - 1] = now > due ? now - due : 0;
+	}
+
+	atomic_fetch_add(&n_expirations, 1);
+}
+
+static void run(const char* name, chron_timer_backend backend, long n_timers, long interval_ms, long duration_ms) {
+	chron_timer_t** timers = calloc(n_timers, sizeof(chron_timer_t*));
+	timer_ctx_t* ctxs = calloc(n_timers, sizeof(timer_ctx_t));
+	long capacity = duration_ms / interval_ms + 1;
+	uint64_t* samples = calloc(n_timers * capacity, sizeof(uint64_t));
+	bench_summary_t summary;
+	uint64_t cpu_ns;
+	uint64_t wall_ns;
+	long n_samples = 0;
+
+	chron_timer_set_backend(backend);
+	atomic_store(&n_expirations, 0);
+
+	for (long i = 0; i < n_timers; i++) {
+		ctxs[i].interval_ns = interval_ms * CHRON_NS_PER_MS;
+		ctxs[i].samples = &samples[i * capacity];
+		ctxs[i].capacity = capacity;
+
+		timers[i] = chron_timer_init(on_expiry, &ctxs[i], interval_ms, interval_ms, 0, false);
+	}
+
+	cpu_ns = bench_cpu_ns();
+	wall_ns = bench_now_ns();
+
+	for (long i = 0; i < n_timers; i++) {
+		ctxs[i].start_ns = bench_now_ns();
+		chron_timer_start(timers[i]);
+	}
+
+	usleep(duration_ms * 1000);
+
+	for (long i = 0; i < n_timers; i++) {
+		chron_timer_delete(timers[i]);
+	}
+
+	cpu_ns = bench_cpu_ns() - cpu_ns;
+	wall_ns = bench_now_ns() - wall_ns;
+
+	long n = atomic_load(&n_expirations);
+
+	// POSIX timer callbacks may still be in flight after deletion; let them drain
+	usleep(100000);
+
+	for (long i = 0; i < n_timers; i++) {
+		long k = (long)ctxs[i].n < capacity ? (long)ctxs[i].n : capacity;
+
+		memmove(&samples[n_samples], ctxs[i].samples, k * sizeof(uint64_t));
+		n_samples += k;
+	}
+
+	bench_summarize(samples, n_samples, &summary);
+
+	for (long i = 0; i < n_timers; i++) {
+		free(timers[i]);
+	}
+
+	printf(
+		"{\"bench\":\"timer_overhead\",\"backend\":\"%s\",\"timers\":%ld,\"interval_ns\":%lu,"
+		"\"expirations\":%ld,\"wall_ns\":%lu,\"cpu_ns\":%lu,\"cpu_ns_per_expiry\":%.0f,",
+		name,
+		n_timers,
+		(uint64_t)interval_ms * CHRON_NS_PER_MS,
+		n,
+		wall_ns,
+		cpu_ns,
+		n ? (double)cpu_ns / n : 0
+	);
+	bench_print_summary("late", &summary);
+	printf("}\n");
+
+	free(timers);
+	free(ctxs);
+	free(samples);
+}
+
+int main(void) {
+	long n_timers = bench_param("CHRON_BENCH_TIMERS", 100);
+	long interval_ms = bench_param("CHRON_BENCH_INTERVAL_MS", 10);
+	long duration_ms = bench_param("CHRON_BENCH_DURATION_MS", 2000);
+
+	run("posix", TIMER_BACKEND_POSIX, n_timers, interval_ms, duration_ms);
+	run("timerfd", TIMER_BACKEND_TIMERFD, n_timers, interval_ms, duration_ms);
+	run("wheel", TIMER_BACKEND_WHEEL, n_timers, interval_ms, duration_ms);
+
+	return 0;
+}
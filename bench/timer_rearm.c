@@ -0,0 +1,115 @@
+#include "bench.h"
+
+/**
+ * Kernel timer programming per chron_timer_t expiration, on each backend, for
+ * three ways of re-arming a timer: periodic timers, which the kernel (or the
+ * dispatcher) re-arms on its own; exponential timers, which chron re-arms with
+ * a doubled backoff after each expiration; and timers whose callback pushes
+ * their deadline out with chron_timer_reschedule, as a retry layer would.
+ * Counts are taken from chron_timer_get_stats and include starting the timers.
+ *
+ * Parameters (environment):
+ *   CHRON_BENCH_TIMERS         number of concurrent timers (default 100)
+ *   CHRON_BENCH_INTERVAL_MS    period, or initial backoff, of each timer, in ms (default 10)
+ *   CHRON_BENCH_DURATION_MS    length of each run, in ms (default 2000)
+ *   CHRON_BENCH_BACKOFF_STEPS  expirations of each exponential timer (default 6)
+ */
+
+typedef enum {
+	REARM_PERIODIC,
+	REARM_EXPONENTIAL,
+	REARM_RESCHEDULED
+} rearm_mode;
+
+static const char* mode_names[] = { "periodic", "exponential", "rescheduled" };
+
+static long interval_ms;
+
+static void on_expiry(chron_timer_t* timer, void* arg) {
+	(void)arg;
+	(void)timer;
+}
+
+static void on_expiry_reschedule(chron_timer_t* timer, void* arg) {
+	(void)arg;
+
+	chron_timer_reschedule(timer, interval_ms, 0);
+}
+
+/**
+ * Run the benchmark for the given backend and re-arm mode
+ */
+static void run(const char* name, chron_timer_backend backend, rearm_mode mode, long n_timers, long duration_ms, long n_steps) {
+	chron_timer_t** timers = calloc(n_timers, sizeof(chron_timer_t*));
+	chron_timer_stats_t before;
+	chron_timer_stats_t after;
+
+	chron_timer_set_backend(backend);
+
+	for (long i = 0; i < n_timers; i++) {
+		switch (mode) {
+			case REARM_PERIODIC:
+				timers[i] = chron_timer_init(on_expiry, NULL, interval_ms, interval_ms, 0, false);
+				break;
+			case REARM_EXPONENTIAL:
+				timers[i] = chron_timer_init(on_expiry, NULL, interval_ms, 0, n_steps, true);
+				break;
+			case REARM_RESCHEDULED:
+				timers[i] = chron_timer_init(on_expiry_reschedule, NULL, interval_ms, 0, 0, false);
+				break;
+		}
+	}
+
+	chron_timer_get_stats(&before);
+
+	for (long i = 0; i < n_timers; i++) {
+		chron_timer_start(timers[i]);
+	}
+
+	usleep(duration_ms * 1000);
+
+	chron_timer_get_stats(&after);
+
+	for (long i = 0; i < n_timers; i++) {
+		chron_timer_delete(timers[i]);
+	}
+
+	// POSIX timer callbacks may still be in flight after deletion; let them drain
+	usleep(100000);
+
+	uint64_t n_fired = after.n_fired - before.n_fired;
+	uint64_t n_settime = after.n_settime - before.n_settime;
+
+	printf(
+		"{\"bench\":\"timer_rearm\",\"backend\":\"%s\",\"mode\":\"%s\",\"timers\":%ld,"
+		"\"expirations\":%lu,\"settime\":%lu,\"settime_per_expiry\":%.2f}\n",
+		name,
+		mode_names[mode],
+		n_timers,
+		n_fired,
+		n_settime,
+		n_fired ? (double)n_settime / n_fired : 0
+	);
+
+	for (long i = 0; i < n_timers; i++) {
+		free(timers[i]);
+	}
+
+	free(timers);
+}
+
+int main(void) {
+	long n_timers = bench_param("CHRON_BENCH_TIMERS", 100);
+	long duration_ms = bench_param("CHRON_BENCH_DURATION_MS", 2000);
+	long n_steps = bench_param("CHRON_BENCH_BACKOFF_STEPS", 6);
+
+	interval_ms = bench_param("CHRON_BENCH_INTERVAL_MS", 10);
+
+	for (int mode = REARM_PERIODIC; mode <= REARM_RESCHEDULED; mode++) {
+		run("posix", TIMER_BACKEND_POSIX, mode, n_timers, duration_ms, n_steps);
+		run("timerfd", TIMER_BACKEND_TIMERFD, mode, n_timers, duration_ms, n_steps);
+		run("wheel", TIMER_BACKEND_WHEEL, mode, n_timers, duration_ms, n_steps);
+	}
+
+	return 0;
+}
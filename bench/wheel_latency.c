@@ -0,0 +1,97 @@
+#include "bench.h"
+
+/**
+ * Expiry dispatch latency and jitter of chron_timer_wheel_t: how late each
+ * one-shot event's callback runs relative to its requested deadline. Since
+ * events never fire early, this includes rounding up to the next tick.
+ *
+ * Parameters (environment):
+ *   CHRON_BENCH_EVENTS   number of events (default 20000)
+ *   CHRON_BENCH_TICK_US  tick length, in us (default 100)
+ *   CHRON_BENCH_SPAN_MS  events are spread evenly over this many ms (default 1000)
+ */
+
+typedef struct event {
+	/* CLOCK_MONOTONIC time at which the event was due, in ns */
+	uint64_t due_ns;
+
+	/* how late the callback ran, in ns */
+	uint64_t late_ns;
+
+	atomic_bool is_fired;
+} event_t;
+
+static atomic_long n_fired;
+
+static void on_expiry(void* arg, int arg_size) {
+	event_t* ev = (event_t*)arg;
+	uint64_t now = bench_now_ns();
+
+	(void)arg_size;
+
+	ev->late_ns = now > ev->due_ns ? now - ev->due_ns : 0;
+	atomic_store(&ev->is_fired, true);
+	atomic_fetch_add(&n_fired, 1);
+}
+
+int main(void) {
+	long n_events = bench_param("CHRON_BENCH_EVENTS", 20000);
+	long tick_us = bench_param("CHRON_BENCH_TICK_US", 100);
+	long span_ms = bench_param("CHRON_BENCH_SPAN_MS", 1000);
+	chron_tw_opts_t opts = {
+		.size = 1024,
+		.tick_interval = tick_us,
+		.resolution_ns = CHRON_NS_PER_US
+	};
+	chron_timer_wheel_t* tw = chron_timer_wheel_init_opts(&opts);
+	event_t* events = calloc(n_events, sizeof(event_t));
+	uint64_t* samples = calloc(n_events, sizeof(uint64_t));
+	bench_summary_t summary;
+	uint64_t cpu_ns;
+	uint64_t deadline;
+
+	chron_timer_wheel_start(tw);
+	cpu_ns = bench_cpu_ns();
+
+	for (long i = 0; i < n_events; i++) {
+		// intervals in us, spread evenly across the span
+		int interval = 1000 + (i * span_ms * 1000) / n_events;
+
+		events[i].due_ns = bench_now_ns() + (uint64_t)interval * CHRON_NS_PER_US;
+		chron_timer_wheel_register_ev(tw, on_expiry, &events[i], sizeof(event_t), interval, 0);
+	}
+
+	// wait for every event, with a generous margin for overloaded machines
+	deadline = bench_now_ns() + (uint64_t)(span_ms + 5000) * CHRON_NS_PER_MS;
+
+	while (atomic_load(&n_fired) < n_events && bench_now_ns() < deadline) {
+		usleep(1000);
+	}
+
+	chron_timer_wheel_stop(tw);
+	cpu_ns = bench_cpu_ns() - cpu_ns;
+
+	long n = 0;
+
+	for (long i = 0; i < n_events; i++) {
+		if (atomic_load(&events[i].is_fired)) samples[n++] = events[i].late_ns;
+	}
+
+	bench_summarize(samples, n, &summary);
+
+	printf(
+		"{\"bench\":\"wheel_latency\",\"events\":%ld,\"fired\":%ld,\"tick_ns\":%lu,\"cpu_ns\":%lu,",
+		n_events,
+		n,
+		(uint64_t)tick_us * CHRON_NS_PER_US,
+		cpu_ns
+	);
+	bench_print_summary("late", &summary);
+	printf("}\n");
+
+	chron_timer_wheel_destroy(tw);
+	free(events);
+	free(samples);
+
+	return 0;
+}
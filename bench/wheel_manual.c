@@ -0,0 +1,83 @@
+#include "bench.h"
+
+/**
+ * Simulation speed of a manual chron_timer_wheel_t: recurring events with
+ * random intervals are fired by advancing the wheel's clock directly, with no
+ * waiting. Reports ticks and callbacks processed per second of wall time, for
+ * each of the wheel's backends.
+ *
+ * Parameters (environment):
+ *   CHRON_BENCH_EVENTS        number of recurring events (default 100000)
+ *   CHRON_BENCH_TICKS         ticks to advance through (default 1000000)
+ *   CHRON_BENCH_MAX_INTERVAL  events recur every 1 to this many ticks (default 100000)
+ */
+
+/* ticks advanced per call */
+#define BENCH_STEP 1000
+
+static long n_fired;
+
+static void on_expiry(void* arg, int arg_size) {
+	(void)arg;
+	(void)arg_size;
+
+	n_fired++;
+}
+
+/**
+ * Run the benchmark against the given backend
+ */
+static void run(chron_tw_backend backend, long n_events, long n_ticks, long max_interval) {
+	chron_tw_opts_t opts = {
+		.size = 1024,
+		.tick_interval = 1,
+		.resolution_ns = CHRON_NS_PER_US,
+		.prealloc = n_events,
+		.is_manual = true,
+		.backend = backend
+	};
+	chron_timer_wheel_t* tw = chron_timer_wheel_init_opts(&opts);
+	unsigned int seed = 1;
+	uint64_t start_ns;
+	uint64_t elapsed_ns;
+
+	n_fired = 0;
+
+	for (long i = 0; i < n_events; i++) {
+		chron_timer_wheel_register_ev(tw, on_expiry, NULL, 0, 1 + rand_r(&seed) % max_interval, 1);
+	}
+
+	start_ns = bench_now_ns();
+
+	for (long t = 0; t < n_ticks; t += BENCH_STEP) {
+		chron_timer_wheel_advance(tw, BENCH_STEP);
+	}
+
+	elapsed_ns = bench_now_ns() - start_ns;
+
+	printf(
+		"{\"bench\":\"wheel_manual\",\"backend\":\"%s\",\"events\":%ld,\"ticks\":%ld,\"fired\":%ld,"
+		"\"elapsed_ns\":%lu,\"ticks_per_s\":%.0f,\"fired_per_s\":%.0f}\n",
+		backend == TW_BACKEND_HEAP ? "heap" : backend == TW_BACKEND_ARRAY ? "array" : "wheel",
+		n_events,
+		n_ticks,
+		n_fired,
+		elapsed_ns,
+		(double)n_ticks * CHRON_NS_PER_S / elapsed_ns,
+		(double)n_fired * CHRON_NS_PER_S / elapsed_ns
+	);
+
+	chron_timer_wheel_destroy(tw);
+}
+
+int main(void) {
+	long n_events = bench_param("CHRON_BENCH_EVENTS", 100000);
+	long n_ticks = bench_param("CHRON_BENCH_TICKS", 1000000);
+	long max_interval = bench_param("CHRON_BENCH_MAX_INTERVAL", 100000);
+
+	run(TW_BACKEND_WHEEL, n_events, n_ticks, max_interval);
+	run(TW_BACKEND_HEAP, n_events, n_ticks, max_interval);
+	run(TW_BACKEND_ARRAY, n_events, n_ticks, max_interval);
+
+	return 0;
+}
@@ -0,0 +1,86 @@
+#include "bench.h"
+
+/**
+ * Expiry throughput of a manual chron_timer_wheel_t whose slots each hold very
+ * many events, for the linked-list and array slot representations. Events are
+ * registered round-robin across the slots, as they would be by unrelated
+ * producers, so that the events of any one slot are scattered in memory. Each
+ * lands in an outer level first, so is cascaded once before it expires. Reports
+ * the wall time per event to take it through both.
+ *
+ * Parameters (environment):
+ *   CHRON_BENCH_EVENTS_PER_SLOT  number of one-shot events per slot (default 10000)
+ *   CHRON_BENCH_SLOTS            number of slots over which they are spread (default 16)
+ *   CHRON_BENCH_ROUNDS           times the whole set is registered and expired (default 10)
+ */
+
+/* number of level 0 slots; every interval below exceeds it */
+#define BENCH_WHEEL_SIZE 256
+
+static long n_fired;
+
+static void on_expiry(void* arg, int arg_size) {
+	(void)arg;
+	(void)arg_size;
+
+	n_fired++;
+}
+
+/**
+ * Run the benchmark against the given backend
+ */
+static void run(chron_tw_backend backend, long n_per_slot, long n_slots, long n_rounds) {
+	chron_tw_opts_t opts = {
+		.size = BENCH_WHEEL_SIZE,
+		.tick_interval = 1,
+		.resolution_ns = CHRON_NS_PER_US,
+		.prealloc = n_per_slot * n_slots,
+		.is_manual = true,
+		.backend = backend
+	};
+	chron_timer_wheel_t* tw = chron_timer_wheel_init_opts(&opts);
+	uint64_t elapsed_ns = 0;
+	long n_events = n_per_slot * n_slots;
+
+	n_fired = 0;
+
+	for (long r = 0; r < n_rounds; r++) {
+		for (long i = 0; i < n_events; i++) {
+			chron_timer_wheel_register_ev(tw, on_expiry, NULL, 0, BENCH_WHEEL_SIZE * 4 + (i % n_slots) * 7, 0);
+		}
+
+		// apply the registrations outside of the timed section
+		chron_timer_wheel_advance(tw, 1);
+
+		uint64_t start_ns = bench_now_ns();
+
+		chron_timer_wheel_advance(tw, BENCH_WHEEL_SIZE * 4 + n_slots * 7);
+
+		elapsed_ns += bench_now_ns() - start_ns;
+	}
+
+	printf(
+		"{\"bench\":\"wheel_slot_scan\",\"backend\":\"%s\",\"events_per_slot\":%ld,\"slots\":%ld,"
+		"\"fired\":%ld,\"elapsed_ns\":%lu,\"ns_per_event\":%.1f,\"fired_per_s\":%.0f}\n",
+		backend == TW_BACKEND_ARRAY ? "array" : "wheel",
+		n_per_slot,
+		n_slots,
+		n_fired,
+		elapsed_ns,
+		(double)elapsed_ns / n_fired,
+		(double)n_fired * CHRON_NS_PER_S / elapsed_ns
+	);
+
+	chron_timer_wheel_destroy(tw);
+}
+
+int main(void) {
+	long n_per_slot = bench_param("CHRON_BENCH_EVENTS_PER_SLOT", 10000);
+	long n_slots = bench_param("CHRON_BENCH_SLOTS", 16);
+	long n_rounds = bench_param("CHRON_BENCH_ROUNDS", 10);
+
+	run(TW_BACKEND_WHEEL, n_per_slot, n_slots, n_rounds);
+	run(TW_BACKEND_ARRAY, n_per_slot, n_slots, n_rounds);
+
+	return 0;
+}
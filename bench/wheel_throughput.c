@@ -0,0 +1,140 @@
+#include "bench.h"
+
+/**
+ * Producer-side throughput of chron_timer_wheel_t: each producer registers,
+ * reschedules and then unregisters its share of events on a running wheel.
+ * Intervals are far enough out that nothing fires during the run.
+ *
+ * Parameters (environment):
+ *   CHRON_BENCH_OPS            events per producer (default 200000)
+ *   CHRON_BENCH_MAX_PRODUCERS  largest producer count (default: online CPUs)
+ */
+
+/* interval, in s, well beyond the length of the run */
+#define BENCH_INTERVAL 3600
+
+typedef struct producer {
+	pthread_t thread;
+
+	chron_timer_wheel_t* tw;
+
+	pthread_barrier_t* barrier;
+
+	chron_tw_slot_el_t** els;
+
+	long n_ops;
+
+	/* time spent in each phase, in ns */
+	uint64_t register_ns;
+
+	uint64_t reschedule_ns;
+
+	uint64_t unregister_ns;
+} producer_t;
+
+static void noop(void* arg, int arg_size) {
+	(void)arg;
+	(void)arg_size;
+}
+
+static void* producer_routine(void* arg) {
+	producer_t* p = (producer_t*)arg;
+	uint64_t start;
+
+	pthread_barrier_wait(p->barrier);
+
+	start = bench_now_ns();
+	for (long i = 0; i < p->n_ops; i++) {
+		p->els[i] = chron_timer_wheel_register_ev(p->tw, noop, NULL, 0, BENCH_INTERVAL, 0);
+	}
+	p->register_ns = bench_now_ns() - start;
+
+	pthread_barrier_wait(p->barrier);
+
+	start = bench_now_ns();
+	for (long i = 0; i < p->n_ops; i++) {
+		chron_timer_wheel_reschedule_ev(p->tw, p->els[i], BENCH_INTERVAL + 1);
+	}
+	p->reschedule_ns = bench_now_ns() - start;
+
+	pthread_barrier_wait(p->barrier);
+
+	start = bench_now_ns();
+	for (long i = 0; i < p->n_ops; i++) {
+		chron_timer_wheel_unregister_ev(p->tw, p->els[i]);
+	}
+	p->unregister_ns = bench_now_ns() - start;
+
+	return NULL;
+}
+
+static void report(const char* op, int n_producers, long n_ops, uint64_t ns) {
+	printf(
+		"{\"bench\":\"wheel_throughput\",\"op\":\"%s\",\"producers\":%d,\"ops\":%ld,"
+		"\"ns\":%lu,\"ops_per_sec\":%.0f}\n",
+		op,
+		n_producers,
+		n_ops,
+		ns,
+		ns ? n_ops * (double)CHRON_NS_PER_S / ns : 0
+	);
+}
+
+static void run(int n_producers, long n_ops) {
+	chron_tw_opts_t opts = {
+		.size = 1024,
+		.tick_interval = 1,
+		.resolution_ns = CHRON_NS_PER_S
+	};
+	chron_timer_wheel_t* tw = chron_timer_wheel_init_opts(&opts);
+	producer_t* producers = calloc(n_producers, sizeof(producer_t));
+	pthread_barrier_t barrier;
+	uint64_t register_ns = 0, reschedule_ns = 0, unregister_ns = 0;
+
+	pthread_barrier_init(&barrier, NULL, n_producers);
+	chron_timer_wheel_start(tw);
+
+	for (int i = 0; i < n_producers; i++) {
+		producers[i].tw = tw;
+		producers[i].barrier = &barrier;
+		producers[i].n_ops = n_ops;
+		producers[i].els = calloc(n_ops, sizeof(chron_tw_slot_el_t*));
+
+		pthread_create(&producers[i].thread, NULL, producer_routine, &producers[i]);
+	}
+
+	// phases are timed from the first producer's start to the slowest producer's finish
+	for (int i = 0; i < n_producers; i++) {
+		pthread_join(producers[i].thread, NULL);
+
+		if (producers[i].register_ns > register_ns) register_ns = producers[i].register_ns;
+		if (producers[i].reschedule_ns > reschedule_ns) reschedule_ns = producers[i].reschedule_ns;
+		if (producers[i].unregister_ns > unregister_ns) unregister_ns = producers[i].unregister_ns;
+
+		free(producers[i].els);
+	}
+
+	report("register", n_producers, n_ops * n_producers, register_ns);
+	report("reschedule", n_producers, n_ops * n_producers, reschedule_ns);
+	report("unregister", n_producers, n_ops * n_producers, unregister_ns);
+
+	chron_timer_wheel_destroy(tw);
+	pthread_barrier_destroy(&barrier);
+	free(producers);
+}
+
+int main(void) {
+	long n_ops = bench_param("CHRON_BENCH_OPS", 200000);
+	int max_producers = bench_param("CHRON_BENCH_MAX_PRODUCERS", bench_n_cpus());
+
+	for (int n_producers = 1; n_producers <= max_producers; n_producers *= 2) {
+		run(n_producers, n_ops);
+
+		// always measure the largest count, even if it is not a power of two
+		if (n_producers < max_producers && n_producers * 2 > max_producers) {
+			run(max_producers, n_ops);
+		}
+	}
+
+	return 0;
+}
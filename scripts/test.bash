@@ -21,24 +21,38 @@ not_test_file () {
 	done
 }
 
+declare -a FAILED_TESTS=()
+
 run_test () {
 	local file_name="$1"
 
-	gcc -Isrc -Ideps -c "$TESTING_DIR/$file_name" -o main.o
-	gcc -o main main.o -L./ -l $REPO_DIR
-
-	export LD_LIBRARY_PATH=$HOME/repositories/$REPO_DIR/src/:$LD_LIBRARY_PATH
-	green "\n[+] Running test...\n\n"
+	green "\n[+] Running test $file_name...\n\n"
 
-	./main
+	# a test that fails to build, or exits non-zero, fails the run
+	if ! gcc -Isrc -Ideps -c "$TESTING_DIR/$file_name" -o main.o ||
+		! gcc -o main main.o -L./ -l $REPO_DIR ||
+		! ./main; then
+		red "\n[x] $file_name failed\n"
+		FAILED_TESTS+=("$file_name")
+	fi
 }
 
 main () {
 	make
 
+	# the library just built, not one installed elsewhere
+	export LD_LIBRARY_PATH=$PWD${LD_LIBRARY_PATH:+:$LD_LIBRARY_PATH}
+
 	declare -a tests=($(ls $TESTING_DIR | filter not_test_file))
 
 	for_each run_test ${tests[*]}
+
+	if (( ${#FAILED_TESTS[@]} )); then
+		red "\n[x] ${#FAILED_TESTS[@]} of ${#tests[@]} tests failed: ${FAILED_TESTS[@]}\n"
+		exit 1
+	fi
+
+	green "\n[+] All ${#tests[@]} tests passed\n"
 }
 
 . "$(dirname "$(readlink -f "$BASH_SOURCE")")"/$UTIL_F
@@ -0,0 +1,143 @@
+#include "internal.h"
+
+/* initial room in a slot's array */
+#define CHRON_TW_ARRAY_PREALLOC 16
+
+/* how many entries ahead of the one being taken out of a slot we prefetch */
+#define CHRON_TW_ARRAY_PREFETCH 4
+
+/**
+ * @brief The slots of a TW_BACKEND_ARRAY wheel keep their els in a contiguous
+ * array, in the order they were appended. Taking els out of a slot, whether to
+ * expire or to cascade them, is then a sequential scan that prefetches the els
+ * ahead of it, rather than a walk of a linked list that must load each el to
+ * find the next. An el unlinked from the middle of a slot leaves a hole, which
+ * is skipped; holes are compacted away when the array would otherwise grow.
+ * All of these operations require the slot's lock.
+ */
+
+/* HELPERS */
+
+/**
+ * @brief Opaque helper. Move a slot's live entries to the front of its array
+ *
+ * @param slot
+ */
+void __tw_array_compact(chron_tw_slot* slot) {
+	unsigned long len = 0;
+
+	for (unsigned long i = slot->array_head; i < slot->array_len; i++) {
+		if (!slot->array_els[i]) continue;
+
+		slot->array_els[len] = slot->array_els[i];
+		slot->array_els[len]->array_idx = len;
+		len++;
+	}
+
+	slot->array_head = 0;
+	slot->array_len = len;
+}
+
+/**
+ * @brief Opaque helper. Make room for one more entry at the end of a slot's
+ * array, compacting it if at least half its entries are holes, or else
+ * doubling it
+ *
+ * @param slot
+ * @return bool false if we are out of memory
+ */
+bool __tw_array_make_room(chron_tw_slot* slot) {
+	if (slot->array_len < slot->array_capacity) return true;
+
+	if (slot->array_n_live <= slot->array_capacity / 2 && slot->array_capacity) {
+		__tw_array_compact(slot);
+		return true;
+	}
+
+	unsigned long capacity = slot->array_capacity ? slot->array_capacity * 2 : CHRON_TW_ARRAY_PREALLOC;
+	struct tw_slot_el** els = realloc(slot->array_els, capacity * sizeof(struct tw_slot_el*));
+
+	if (!els) return false;
+
+	slot->array_els = els;
+	slot->array_capacity = capacity;
+
+	return true;
+}
+
+/* INTERNAL API */
+
+/**
+ * @brief Append an el to the end of a slot's array
+ *
+ * @param slot
+ * @param el
+ * @return bool false if we are out of memory, in which case the el was not appended
+ */
+bool __tw_array_append(chron_tw_slot* slot, chron_tw_slot_el_t* el) {
+	if (!__tw_array_make_room(slot)) return false;
+
+	el->array_idx = slot->array_len;
+
+	slot->array_els[slot->array_len++] = el;
+	slot->array_n_live++;
+
+	return true;
+}
+
+/**
+ * @brief Remove an el from a slot's array in O(1), leaving a hole behind it
+ *
+ * @param slot
+ * @param el
+ * @return bool false if the el is not in the slot's array
+ */
+bool __tw_array_remove(chron_tw_slot* slot, chron_tw_slot_el_t* el) {
+	unsigned long i = el->array_idx;
+
+	if (i < slot->array_head || i >= slot->array_len || slot->array_els[i] != el) return false;
+
+	slot->array_els[i] = NULL;
+	slot->array_n_live--;
+
+	// a drained slot starts over at the front of its array
+	if (!slot->array_n_live) {
+		slot->array_head = 0;
+		slot->array_len = 0;
+	} else {
+		while (!slot->array_els[slot->array_head]) slot->array_head++;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Get the first el of a slot's array, prefetching one that follows it
+ *
+ * @param slot
+ * @return chron_tw_slot_el_t* NULL if the slot's array is empty
+ */
+chron_tw_slot_el_t* __tw_array_first(chron_tw_slot* slot) {
+	unsigned long i = slot->array_head;
+
+	if (i >= slot->array_len) return NULL;
+
+	// the entry may be a hole; prefetching NULL is harmless
+	if (i + CHRON_TW_ARRAY_PREFETCH < slot->array_len) {
+		__builtin_prefetch(slot->array_els[i + CHRON_TW_ARRAY_PREFETCH]);
+	}
+
+	return slot->array_els[i];
+}
+
+/**
+ * @brief Free the array of every slot of a wheel
+ *
+ * @param tw
+ * @param n_slots
+ */
+void __tw_array_destroy(chron_timer_wheel_t* tw, int n_slots) {
+	for (int i = 0; i < n_slots; i++) {
+		free(tw->slots[i].array_els);
+	}
+}
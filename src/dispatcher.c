@@ -0,0 +1,550 @@
+#include "internal.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+/**
+ * @brief Multiplexes every TIMER_BACKEND_TIMERFD chron_timer onto a single
+ * timerfd. Each expiration may be delivered anywhere between its deadline and
+ * its deadline plus the timer's slack. Armed timers are kept in a min-heap
+ * ordered by the latter; the timerfd is programmed for the earliest such
+ * deadline, and only reprogrammed when it changes. A single dispatcher thread
+ * waits on the timerfd through epoll and, on each wakeup, delivers every
+ * expiration whose window has opened, so that timers with overlapping windows
+ * share a wakeup.
+ */
+typedef struct chron_dispatcher {
+	pthread_mutex_t mutex;
+
+	int epoll_fd;
+
+	int timer_fd;
+
+	pthread_t thread;
+
+	/* min-heap of armed timers, ordered by deadline plus slack */
+	chron_timer_t** heap;
+
+	int heap_size;
+
+	/* kept at least `n_registered`, so that arming a timer never allocates */
+	int heap_capacity;
+
+	/* timers attached to the dispatcher */
+	int n_registered;
+
+	/* deadline for which the timerfd is currently programmed, 0 if disarmed */
+	uint64_t armed_ns;
+
+	/* timers collected for delivery at the current wakeup, in order; an entry is
+	cleared if its timer is unregistered before it is delivered */
+	chron_timer_t** due;
+
+	int n_due;
+
+	int due_capacity;
+
+	/* scratch space for the search for open windows */
+	int* stack;
+
+	int stack_capacity;
+
+	/* timer whose callback the dispatcher thread is running, if any; unregistering
+	it waits on `delivered` until the callback returns */
+	chron_timer_t* delivering;
+
+	pthread_cond_t delivered;
+
+	/* greatest slack any timer has been given; a subtree of the heap whose root's
+	latest deadline is further than this past now holds no open window */
+	uint64_t max_slack_ns;
+
+	/* whether initialization succeeded */
+	bool is_ready;
+} chron_dispatcher_t;
+
+static chron_dispatcher_t dispatcher = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.delivered = PTHREAD_COND_INITIALIZER,
+	.epoll_fd = -1,
+	.timer_fd = -1
+};
+
+static pthread_once_t dispatcher_once = PTHREAD_ONCE_INIT;
+
+/* HELPERS */
+
+/**
+ * @brief Opaque helper. Get the current CLOCK_MONOTONIC time in ns
+ *
+ * @return uint64_t
+ */
+uint64_t __dispatcher_now_ns(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * CHRON_NS_PER_S + now.tv_nsec;
+}
+
+/**
+ * @brief Opaque helper. Get the latest time at which a timer's next
+ * expiration may be delivered, in ns
+ *
+ * @param timer
+ * @return uint64_t
+ */
+uint64_t __dispatcher_latest_ns(chron_timer_t* timer) {
+	return timer->deadline_ns + timer->slack_ns;
+}
+
+/**
+ * @brief Opaque helper. Swap two heap entries, keeping their indices current
+ *
+ * @param i
+ * @param j
+ */
+void __heap_swap(int i, int j) {
+	chron_timer_t* tmp = dispatcher.heap[i];
+
+	dispatcher.heap[i] = dispatcher.heap[j];
+	dispatcher.heap[j] = tmp;
+
+	dispatcher.heap[i]->heap_idx = i;
+	dispatcher.heap[j]->heap_idx = j;
+}
+
+/**
+ * @brief Opaque helper. Restore the heap property upward from `i`
+ *
+ * @param i
+ */
+void __heap_sift_up(int i) {
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+
+		if (__dispatcher_latest_ns(dispatcher.heap[parent]) <= __dispatcher_latest_ns(dispatcher.heap[i])) break;
+
+		__heap_swap(i, parent);
+		i = parent;
+	}
+}
+
+/**
+ * @brief Opaque helper. Restore the heap property downward from `i`
+ *
+ * @param i
+ */
+void __heap_sift_down(int i) {
+	while (true) {
+		int smallest = i;
+		int left = 2 * i + 1;
+		int right = left + 1;
+
+		if (left < dispatcher.heap_size &&
+			__dispatcher_latest_ns(dispatcher.heap[left]) < __dispatcher_latest_ns(dispatcher.heap[smallest])) {
+			smallest = left;
+		}
+
+		if (right < dispatcher.heap_size &&
+			__dispatcher_latest_ns(dispatcher.heap[right]) < __dispatcher_latest_ns(dispatcher.heap[smallest])) {
+			smallest = right;
+		}
+
+		if (smallest == i) break;
+
+		__heap_swap(i, smallest);
+		i = smallest;
+	}
+}
+
+/**
+ * @brief Opaque helper. Insert a timer into the heap, which has room for
+ * every registered timer
+ *
+ * @param timer
+ */
+void __heap_insert(chron_timer_t* timer) {
+	timer->heap_idx = dispatcher.heap_size++;
+	dispatcher.heap[timer->heap_idx] = timer;
+
+	__heap_sift_up(timer->heap_idx);
+}
+
+/**
+ * @brief Opaque helper. Remove a timer from the heap, if present
+ *
+ * @param timer
+ */
+void __heap_remove(chron_timer_t* timer) {
+	int i = timer->heap_idx;
+
+	if (i < 0) return;
+
+	timer->heap_idx = -1;
+
+	if (i == --dispatcher.heap_size) return;
+
+	chron_timer_t* moved = dispatcher.heap[dispatcher.heap_size];
+
+	dispatcher.heap[i] = moved;
+	moved->heap_idx = i;
+
+	__heap_sift_up(i);
+	__heap_sift_down(moved->heap_idx);
+}
+
+/**
+ * @brief Opaque helper. Order timers by deadline, for qsort
+ *
+ * @param a
+ * @param b
+ * @return int
+ */
+int __dispatcher_deadline_cmp(const void* a, const void* b) {
+	uint64_t x = (*(chron_timer_t* const*)a)->deadline_ns;
+	uint64_t y = (*(chron_timer_t* const*)b)->deadline_ns;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief Opaque helper. Collect every timer in the heap whose window has opened
+ * by `now` into `due`. The heap is ordered by the latest deadline of each
+ * window, so open windows may lie anywhere in it; only subtrees whose every
+ * window must still be closed are skipped. The caller must hold the dispatcher mutex.
+ *
+ * @param now
+ */
+void __dispatcher_collect_due(uint64_t now) {
+	int n_stack = 0;
+
+	dispatcher.n_due = 0;
+
+	if (!dispatcher.heap_size) return;
+
+	if (!dispatcher.stack_capacity) {
+		if (!(dispatcher.stack = malloc(64 * sizeof(int)))) return;
+
+		dispatcher.stack_capacity = 64;
+	}
+
+	dispatcher.stack[n_stack++] = 0;
+
+	while (n_stack) {
+		int i = dispatcher.stack[--n_stack];
+		chron_timer_t* timer = dispatcher.heap[i];
+
+		if (__dispatcher_latest_ns(timer) > now + dispatcher.max_slack_ns) continue;
+
+		if (timer->deadline_ns <= now) {
+			if (dispatcher.n_due == dispatcher.due_capacity) {
+				int capacity = dispatcher.due_capacity ? dispatcher.due_capacity * 2 : 64;
+				chron_timer_t** tmp = realloc(dispatcher.due, capacity * sizeof(chron_timer_t*));
+
+				// out of memory; the rest are delivered on the next wakeup
+				if (!tmp) return;
+
+				dispatcher.due = tmp;
+				dispatcher.due_capacity = capacity;
+			}
+
+			dispatcher.due[dispatcher.n_due++] = timer;
+		}
+
+		for (int child = 2 * i + 1; child <= 2 * i + 2 && child < dispatcher.heap_size; child++) {
+			if (n_stack == dispatcher.stack_capacity) {
+				int capacity = dispatcher.stack_capacity * 2;
+				int* tmp = realloc(dispatcher.stack, capacity * sizeof(int));
+
+				if (!tmp) return;
+
+				dispatcher.stack = tmp;
+				dispatcher.stack_capacity = capacity;
+			}
+
+			dispatcher.stack[n_stack++] = child;
+		}
+	}
+}
+
+/**
+ * @brief Opaque helper. Program the timerfd for the earliest deadline in the
+ * heap, if it changed. The caller must hold the dispatcher mutex.
+ */
+void __dispatcher_sync_timerfd(void) {
+	struct itimerspec its;
+	uint64_t next_ns = dispatcher.heap_size ? __dispatcher_latest_ns(dispatcher.heap[0]) : 0;
+
+	if (next_ns == dispatcher.armed_ns) return;
+
+	memset(&its, 0, sizeof(struct itimerspec));
+
+	its.it_value.tv_sec = next_ns / CHRON_NS_PER_S;
+	its.it_value.tv_nsec = next_ns % CHRON_NS_PER_S;
+
+	// an absolute deadline of zero would disarm the timerfd
+	if (next_ns && !its.it_value.tv_sec && !its.it_value.tv_nsec) {
+		its.it_value.tv_nsec = 1;
+	}
+
+	timerfd_settime(dispatcher.timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+	dispatcher.armed_ns = next_ns;
+
+	__timer_stats_add_settime();
+}
+
+/**
+ * @brief Opaque helper. The thread routine on which expirations are delivered
+ *
+ * @param arg
+ * @return void*
+ */
+void* __dispatcher_routine(void* arg) {
+	struct epoll_event ev;
+	uint64_t n_expirations;
+
+	(void)arg;
+
+	while (true) {
+		if (epoll_wait(dispatcher.epoll_fd, &ev, 1, -1) < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+
+		// drain the timerfd; we derive what is due from the heap instead
+		if (read(dispatcher.timer_fd, &n_expirations, sizeof(n_expirations)) < 0 && errno != EAGAIN) {
+			break;
+		}
+
+		pthread_mutex_lock(&dispatcher.mutex);
+
+		uint64_t now = __dispatcher_now_ns();
+
+		// deliver each timer whose window has opened, in order of their deadlines;
+		// we wake again no later than the latest deadline of any we leave
+		__dispatcher_collect_due(now);
+
+		qsort(dispatcher.due, dispatcher.n_due, sizeof(chron_timer_t*), __dispatcher_deadline_cmp);
+
+		for (int i = 0; i < dispatcher.n_due; i++) {
+			chron_timer_t* timer = dispatcher.due[i];
+
+			if (timer->period_ns) {
+				// periodic timers advance on their own schedule; expirations whose
+				// windows closed while we were behind are skipped, as with a POSIX
+				// timer's overrun. One whose window is still open is delivered next
+				timer->deadline_ns += timer->period_ns;
+
+				if (__dispatcher_latest_ns(timer) < now) {
+					uint64_t n_missed = (now - __dispatcher_latest_ns(timer) + timer->period_ns - 1) / timer->period_ns;
+
+					timer->deadline_ns += n_missed * timer->period_ns;
+					__timer_stats_add_missed(n_missed);
+				}
+
+				__heap_sift_up(timer->heap_idx);
+				__heap_sift_down(timer->heap_idx);
+			} else {
+				__heap_remove(timer);
+			}
+		}
+
+		__dispatcher_sync_timerfd();
+
+		// callbacks may re-arm or cancel timers, so the mutex must not be held
+		// while they run; it is retaken to learn whether each timer is still registered
+		for (int i = 0; i < dispatcher.n_due; i++) {
+			chron_timer_t* timer = dispatcher.due[i];
+
+			if (!timer) continue;
+
+			dispatcher.delivering = timer;
+			pthread_mutex_unlock(&dispatcher.mutex);
+
+			__callback_wrapper((union sigval){ .sival_ptr = timer });
+
+			pthread_mutex_lock(&dispatcher.mutex);
+			dispatcher.delivering = NULL;
+			pthread_cond_broadcast(&dispatcher.delivered);
+		}
+
+		dispatcher.n_due = 0;
+
+		pthread_mutex_unlock(&dispatcher.mutex);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Opaque helper. Create the timerfd, epoll instance and dispatcher thread
+ */
+void __dispatcher_init(void) {
+	struct epoll_event ev;
+	pthread_attr_t attr;
+
+	dispatcher.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (dispatcher.epoll_fd < 0) return;
+
+	dispatcher.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (dispatcher.timer_fd < 0) goto err;
+
+	memset(&ev, 0, sizeof(struct epoll_event));
+	ev.events = EPOLLIN;
+	ev.data.fd = dispatcher.timer_fd;
+
+	if (epoll_ctl(dispatcher.epoll_fd, EPOLL_CTL_ADD, dispatcher.timer_fd, &ev) < 0) goto err;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	if (pthread_create(&dispatcher.thread, &attr, __dispatcher_routine, NULL)) {
+		pthread_attr_destroy(&attr);
+		goto err;
+	}
+
+	pthread_attr_destroy(&attr);
+	dispatcher.is_ready = true;
+
+	return;
+
+err:
+	if (dispatcher.timer_fd >= 0) close(dispatcher.timer_fd);
+	close(dispatcher.epoll_fd);
+
+	dispatcher.epoll_fd = -1;
+	dispatcher.timer_fd = -1;
+}
+
+/* INTERNAL API */
+
+/**
+ * @brief Attach a timer to the dispatcher, starting the dispatcher if necessary
+ *
+ * @param timer
+ * @return bool
+ */
+bool __dispatcher_register(chron_timer_t* timer) {
+	pthread_once(&dispatcher_once, __dispatcher_init);
+
+	if (!dispatcher.is_ready) return false;
+
+	timer->heap_idx = -1;
+	timer->deadline_ns = 0;
+	timer->period_ns = 0;
+
+	pthread_mutex_lock(&dispatcher.mutex);
+
+	// reserve the timer's place in the heap now, so that arming it cannot fail
+	if (dispatcher.n_registered == dispatcher.heap_capacity) {
+		int capacity = dispatcher.heap_capacity ? dispatcher.heap_capacity * 2 : 64;
+		chron_timer_t** heap = realloc(dispatcher.heap, capacity * sizeof(chron_timer_t*));
+
+		if (!heap) {
+			pthread_mutex_unlock(&dispatcher.mutex);
+			return false;
+		}
+
+		dispatcher.heap = heap;
+		dispatcher.heap_capacity = capacity;
+	}
+
+	dispatcher.n_registered++;
+
+	pthread_mutex_unlock(&dispatcher.mutex);
+
+	return true;
+}
+
+/**
+ * @brief Arm the timer to expire at the CLOCK_MONOTONIC time `deadline_ns`, and
+ * every `period_ns` thereafter if nonzero. A zero `deadline_ns` disarms the timer.
+ *
+ * @param timer
+ * @param deadline_ns
+ * @param period_ns
+ */
+void __dispatcher_arm(chron_timer_t* timer, uint64_t deadline_ns, uint64_t period_ns) {
+	pthread_mutex_lock(&dispatcher.mutex);
+
+	__heap_remove(timer);
+
+	if (deadline_ns) {
+		timer->deadline_ns = deadline_ns;
+		timer->period_ns = period_ns;
+
+		__heap_insert(timer);
+	}
+
+	__dispatcher_sync_timerfd();
+
+	pthread_mutex_unlock(&dispatcher.mutex);
+}
+
+/**
+ * @brief Set how late the timer's expirations may be delivered
+ *
+ * @param timer
+ * @param slack_ns
+ */
+void __dispatcher_set_slack(chron_timer_t* timer, uint64_t slack_ns) {
+	pthread_mutex_lock(&dispatcher.mutex);
+
+	timer->slack_ns = slack_ns;
+
+	if (slack_ns > dispatcher.max_slack_ns) dispatcher.max_slack_ns = slack_ns;
+
+	if (timer->heap_idx >= 0) {
+		__heap_sift_up(timer->heap_idx);
+		__heap_sift_down(timer->heap_idx);
+		__dispatcher_sync_timerfd();
+	}
+
+	pthread_mutex_unlock(&dispatcher.mutex);
+}
+
+/**
+ * @brief Detach a timer from the dispatcher. Once this returns, the timer's
+ * callback is neither running nor ever invoked again, unless this is called
+ * from that callback. The caller must not hold the timer, as the callback may
+ * be waiting on it.
+ *
+ * @param timer
+ */
+void __dispatcher_unregister(chron_timer_t* timer) {
+	pthread_mutex_lock(&dispatcher.mutex);
+
+	__heap_remove(timer);
+	__dispatcher_sync_timerfd();
+
+	dispatcher.n_registered--;
+
+	// drop any delivery collected but not yet made
+	for (int i = 0; i < dispatcher.n_due; i++) {
+		if (dispatcher.due[i] == timer) dispatcher.due[i] = NULL;
+	}
+
+	while (dispatcher.delivering == timer && !pthread_equal(pthread_self(), dispatcher.thread)) {
+		pthread_cond_wait(&dispatcher.delivered, &dispatcher.mutex);
+	}
+
+	pthread_mutex_unlock(&dispatcher.mutex);
+}
+
+/**
+ * @brief Get the number of timers currently armed on the dispatcher
+ *
+ * @return uint64_t
+ */
+uint64_t __dispatcher_get_n_armed(void) {
+	uint64_t n_armed;
+
+	pthread_mutex_lock(&dispatcher.mutex);
+	n_armed = dispatcher.heap_size;
+	pthread_mutex_unlock(&dispatcher.mutex);
+
+	return n_armed;
+}
@@ -0,0 +1,272 @@
+#include "internal.h"
+
+/* number of children of each heap node */
+#define CHRON_TW_HEAP_ARITY 4
+
+/**
+ * @brief The scheduler of a TW_BACKEND_HEAP wheel: a 4-ary min-heap of els
+ * ordered by deadline, and by the order in which they were placed among equal
+ * deadlines. The heap stands in for every slot of the wheel; it is guarded by
+ * the mutex of `slot`, and each el in the heap points its `slot_head` there.
+ */
+struct chron_tw_heap {
+	chron_tw_slot slot;
+
+	chron_tw_slot_el_t** els;
+
+	unsigned long size;
+
+	unsigned long capacity;
+
+	/* number of registered els, each of which is guaranteed room in `els` */
+	unsigned long n_reserved;
+
+	/* sequence number given to the next el placed */
+	uint64_t next_seq;
+};
+
+/* HELPERS */
+
+/**
+ * @brief Opaque helper. Whether el `a` is due before el `b`
+ *
+ * @param a
+ * @param b
+ * @return bool
+ */
+bool __tw_heap_less(chron_tw_slot_el_t* a, chron_tw_slot_el_t* b) {
+	return a->expires < b->expires || (a->expires == b->expires && a->heap_seq < b->heap_seq);
+}
+
+/**
+ * @brief Opaque helper. Store an el at the given position of the heap
+ *
+ * @param heap
+ * @param i
+ * @param el
+ */
+void __tw_heap_set(chron_tw_heap_t* heap, unsigned long i, chron_tw_slot_el_t* el) {
+	heap->els[i] = el;
+	el->heap_idx = i;
+}
+
+/**
+ * @brief Opaque helper. Restore the heap property upward from `i`
+ *
+ * @param heap
+ * @param i
+ */
+void __tw_heap_sift_up(chron_tw_heap_t* heap, unsigned long i) {
+	chron_tw_slot_el_t* el = heap->els[i];
+
+	while (i > 0) {
+		unsigned long parent = (i - 1) / CHRON_TW_HEAP_ARITY;
+
+		if (!__tw_heap_less(el, heap->els[parent])) break;
+
+		__tw_heap_set(heap, i, heap->els[parent]);
+		i = parent;
+	}
+
+	__tw_heap_set(heap, i, el);
+}
+
+/**
+ * @brief Opaque helper. Restore the heap property downward from `i`
+ *
+ * @param heap
+ * @param i
+ */
+void __tw_heap_sift_down(chron_tw_heap_t* heap, unsigned long i) {
+	chron_tw_slot_el_t* el = heap->els[i];
+
+	while (true) {
+		unsigned long first = i * CHRON_TW_HEAP_ARITY + 1;
+		unsigned long smallest = i;
+		chron_tw_slot_el_t* min = el;
+
+		for (unsigned long c = first; c < first + CHRON_TW_HEAP_ARITY && c < heap->size; c++) {
+			if (__tw_heap_less(heap->els[c], min)) {
+				smallest = c;
+				min = heap->els[c];
+			}
+		}
+
+		if (smallest == i) break;
+
+		__tw_heap_set(heap, i, min);
+		i = smallest;
+	}
+
+	__tw_heap_set(heap, i, el);
+}
+
+/* INTERNAL API */
+
+/**
+ * @brief Create the heap of a TW_BACKEND_HEAP wheel, with room for at least
+ * `prealloc` els
+ *
+ * @param tw
+ * @param prealloc
+ * @return bool
+ */
+bool __tw_heap_init(chron_timer_wheel_t* tw, unsigned long prealloc) {
+	chron_tw_heap_t* heap = calloc(1, sizeof(chron_tw_heap_t));
+
+	if (!heap) return false;
+
+	heap->capacity = prealloc ? prealloc : 64;
+	heap->els = malloc(heap->capacity * sizeof(chron_tw_slot_el_t*));
+
+	if (!heap->els) {
+		free(heap);
+		return false;
+	}
+
+	glthread_init(&heap->slot.linked_list);
+	pthread_mutex_init(&heap->slot.mutex, NULL);
+	atomic_init(&heap->slot.n_els, 0);
+
+	tw->heap = heap;
+
+	return true;
+}
+
+/**
+ * @brief Free a wheel's heap, if it has one
+ *
+ * @param tw
+ */
+void __tw_heap_destroy(chron_timer_wheel_t* tw) {
+	if (!tw->heap) return;
+
+	pthread_mutex_destroy(&tw->heap->slot.mutex);
+	free(tw->heap->els);
+	free(tw->heap);
+
+	tw->heap = NULL;
+}
+
+/**
+ * @brief Get the slot that stands in for every slot of a heap wheel
+ *
+ * @param tw
+ * @return chron_tw_slot*
+ */
+chron_tw_slot* __tw_heap_slot(chron_timer_wheel_t* tw) {
+	return &tw->heap->slot;
+}
+
+/**
+ * @brief Guarantee room in the heap for `n` more registered els, so placing
+ * an el never has to allocate
+ *
+ * @param tw
+ * @param n
+ * @return bool false if we are out of memory, in which case nothing was reserved
+ */
+bool __tw_heap_reserve(chron_timer_wheel_t* tw, unsigned long n) {
+	chron_tw_heap_t* heap = tw->heap;
+	bool ok = true;
+
+	pthread_mutex_lock(&heap->slot.mutex);
+
+	if (heap->n_reserved + n > heap->capacity) {
+		unsigned long capacity = heap->capacity * 2;
+
+		if (capacity < heap->n_reserved + n) capacity = heap->n_reserved + n;
+
+		chron_tw_slot_el_t** els = realloc(heap->els, capacity * sizeof(chron_tw_slot_el_t*));
+
+		if (els) {
+			heap->els = els;
+			heap->capacity = capacity;
+		} else {
+			ok = false;
+		}
+	}
+
+	if (ok) heap->n_reserved += n;
+
+	pthread_mutex_unlock(&heap->slot.mutex);
+
+	return ok;
+}
+
+/**
+ * @brief Give back the room reserved for an unregistered el
+ *
+ * @param tw
+ */
+void __tw_heap_unreserve(chron_timer_wheel_t* tw) {
+	pthread_mutex_lock(&tw->heap->slot.mutex);
+	tw->heap->n_reserved--;
+	pthread_mutex_unlock(&tw->heap->slot.mutex);
+}
+
+/**
+ * @brief Insert an el into the heap. The caller must hold the heap's lock.
+ *
+ * @param tw
+ * @param el
+ */
+void __tw_heap_push(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el) {
+	chron_tw_heap_t* heap = tw->heap;
+
+	el->heap_seq = heap->next_seq++;
+
+	heap->els[heap->size++] = el;
+	__tw_heap_sift_up(heap, heap->size - 1);
+}
+
+/**
+ * @brief Remove an el from the heap in O(log n). The caller must hold the
+ * heap's lock.
+ *
+ * @param tw
+ * @param el
+ */
+void __tw_heap_remove(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el) {
+	chron_tw_heap_t* heap = tw->heap;
+	unsigned long i = el->heap_idx;
+
+	if (i == --heap->size) return;
+
+	chron_tw_slot_el_t* moved = heap->els[heap->size];
+
+	__tw_heap_set(heap, i, moved);
+
+	__tw_heap_sift_up(heap, i);
+	__tw_heap_sift_down(heap, moved->heap_idx);
+}
+
+/**
+ * @brief Get the heap's earliest el. The caller must hold the heap's lock.
+ *
+ * @param tw
+ * @return chron_tw_slot_el_t* NULL if the heap is empty
+ */
+chron_tw_slot_el_t* __tw_heap_peek(chron_timer_wheel_t* tw) {
+	return tw->heap->size ? tw->heap->els[0] : NULL;
+}
+
+/**
+ * @brief Shift the deadline of every el in the heap back by `ticks`. The
+ * order of the heap is unaffected.
+ *
+ * @param tw
+ * @param ticks
+ */
+void __tw_heap_rebase(chron_timer_wheel_t* tw, uint64_t ticks) {
+	chron_tw_heap_t* heap = tw->heap;
+
+	pthread_mutex_lock(&heap->slot.mutex);
+
+	for (unsigned long i = 0; i < heap->size; i++) {
+		heap->els[i]->expires -= ticks;
+		atomic_store(&heap->els[i]->due_tick, heap->els[i]->expires);
+	}
+
+	pthread_mutex_unlock(&heap->slot.mutex);
+}
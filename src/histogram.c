@@ -0,0 +1,177 @@
+#include "internal.h"
+
+/**
+ * @brief A set of latency histograms recorded by a timer wheel. Every bucket
+ * is an independent atomic counter, so recording never takes a lock and
+ * readers can snapshot the histograms while the wheel keeps running.
+ */
+struct chron_tw_latency {
+	struct {
+		_Atomic uint64_t counts[CHRON_TW_HIST_N_BUCKETS];
+
+		_Atomic uint64_t sum_ns;
+
+		_Atomic uint64_t max_ns;
+	} histograms[CHRON_TW_N_LATENCIES];
+};
+
+/* HELPERS */
+
+/**
+ * @brief Opaque helper. Map a value to its bucket. Values below 2^SUB_BITS
+ * each get a bucket of their own; above that, every power of two is split
+ * into 2^SUB_BITS equal buckets.
+ *
+ * @param ns
+ * @return int
+ */
+int __histogram_bucket(uint64_t ns) {
+	int magnitude;
+
+	if (ns < (1ULL << CHRON_TW_HIST_SUB_BITS)) return (int)ns;
+
+	magnitude = 63 - __builtin_clzll(ns);
+
+	if (magnitude >= CHRON_TW_HIST_MAX_BITS) return CHRON_TW_HIST_N_BUCKETS - 1;
+
+	return ((magnitude - CHRON_TW_HIST_SUB_BITS + 1) << CHRON_TW_HIST_SUB_BITS) +
+		(int)(ns >> (magnitude - CHRON_TW_HIST_SUB_BITS)) - (1 << CHRON_TW_HIST_SUB_BITS);
+}
+
+/**
+ * @brief Opaque helper. Get the highest value that maps to the given bucket
+ *
+ * @param bucket
+ * @return uint64_t
+ */
+uint64_t __histogram_bucket_max(int bucket) {
+	int shift = (bucket >> CHRON_TW_HIST_SUB_BITS) - 1;
+	uint64_t sub = bucket & ((1 << CHRON_TW_HIST_SUB_BITS) - 1);
+
+	if (shift < 0) return (uint64_t)bucket;
+
+	return (((1ULL << CHRON_TW_HIST_SUB_BITS) + sub + 1) << shift) - 1;
+}
+
+/* INTERNAL API */
+
+/**
+ * @brief Allocate a wheel's latency histograms
+ *
+ * @param tw
+ * @return bool
+ */
+bool __latency_init(chron_timer_wheel_t* tw) {
+	tw->latency = calloc(1, sizeof(chron_tw_latency_t));
+
+	return tw->latency != NULL;
+}
+
+/**
+ * @brief Free a wheel's latency histograms
+ *
+ * @param tw
+ */
+void __latency_destroy(chron_timer_wheel_t* tw) {
+	free(tw->latency);
+	tw->latency = NULL;
+}
+
+/**
+ * @brief Record a sample in one of the wheel's latency histograms. Callers
+ * check that `tw->latency` is set, so that untracked wheels pay only a branch.
+ *
+ * @param tw
+ * @param which
+ * @param ns
+ */
+void __latency_record(chron_timer_wheel_t* tw, chron_tw_latency which, uint64_t ns) {
+	uint64_t max;
+
+	atomic_fetch_add_explicit(
+		&tw->latency->histograms[which].counts[__histogram_bucket(ns)],
+		1,
+		memory_order_relaxed
+	);
+	atomic_fetch_add_explicit(&tw->latency->histograms[which].sum_ns, ns, memory_order_relaxed);
+
+	max = atomic_load_explicit(&tw->latency->histograms[which].max_ns, memory_order_relaxed);
+
+	while (ns > max && !atomic_compare_exchange_weak_explicit(
+		&tw->latency->histograms[which].max_ns,
+		&max,
+		ns,
+		memory_order_relaxed,
+		memory_order_relaxed
+	));
+}
+
+/* PUBLIC API */
+
+/**
+ * @brief Take a snapshot of one of the wheel's latency histograms. This does
+ * not block the wheel; samples recorded while the snapshot is taken may or
+ * may not be included.
+ *
+ * @param tw
+ * @param which
+ * @param hist
+ * @return bool false if the wheel was not initialized with `track_latency`
+ */
+bool chron_timer_wheel_get_latency(
+	chron_timer_wheel_t* tw,
+	chron_tw_latency which,
+	chron_tw_histogram_t* hist
+) {
+	if (!tw || !tw->latency || !hist || which < 0 || which >= CHRON_TW_N_LATENCIES) return false;
+
+	hist->n = 0;
+
+	for (int i = 0; i < CHRON_TW_HIST_N_BUCKETS; i++) {
+		hist->counts[i] = atomic_load_explicit(
+			&tw->latency->histograms[which].counts[i],
+			memory_order_relaxed
+		);
+
+		hist->n += hist->counts[i];
+	}
+
+	hist->sum_ns = atomic_load_explicit(&tw->latency->histograms[which].sum_ns, memory_order_relaxed);
+	hist->max_ns = atomic_load_explicit(&tw->latency->histograms[which].max_ns, memory_order_relaxed);
+
+	return true;
+}
+
+/**
+ * @brief Get the value at the given percentile of a histogram snapshot. The
+ * result is the highest value of the bucket the percentile falls in, so it
+ * overstates the true value by at most 1/2^CHRON_TW_HIST_SUB_BITS.
+ *
+ * @param hist
+ * @param percentile between 0 and 100, e.g. 99.9
+ * @return uint64_t the value in ns; 0 if the histogram is empty
+ */
+uint64_t chron_tw_histogram_percentile(const chron_tw_histogram_t* hist, double percentile) {
+	uint64_t target;
+	uint64_t seen = 0;
+
+	if (!hist || !hist->n) return 0;
+
+	if (percentile < 0) percentile = 0;
+	if (percentile > 100) percentile = 100;
+
+	target = (uint64_t)(percentile / 100 * hist->n + 0.5);
+	if (!target) target = 1;
+
+	for (int i = 0; i < CHRON_TW_HIST_N_BUCKETS; i++) {
+		seen += hist->counts[i];
+
+		if (seen >= target) {
+			uint64_t max = __histogram_bucket_max(i);
+
+			return max < hist->max_ns ? max : hist->max_ns;
+		}
+	}
+
+	return hist->max_ns;
+}
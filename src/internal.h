@@ -0,0 +1,110 @@
+#ifndef LIB_CHRON_INTERNAL_H
+#define LIB_CHRON_INTERNAL_H
+
+#include "libchron.h"
+
+/* Helpers shared between translation units; not part of the public API */
+
+/* timer.c */
+
+void __callback_wrapper(union sigval arg);
+
+void __timer_stats_add_missed(uint64_t n);
+
+void __timer_stats_add_settime(void);
+
+/* dispatcher.c */
+
+bool __dispatcher_register(chron_timer_t* timer);
+
+void __dispatcher_arm(chron_timer_t* timer, uint64_t deadline_ns, uint64_t period_ns);
+
+void __dispatcher_set_slack(chron_timer_t* timer, uint64_t slack_ns);
+
+void __dispatcher_unregister(chron_timer_t* timer);
+
+uint64_t __dispatcher_get_n_armed(void);
+
+/* vtimer.c */
+
+bool __vtimer_register(chron_timer_t* timer);
+
+void __vtimer_arm(chron_timer_t* timer, uint64_t deadline_ns, uint64_t period_ns);
+
+void __vtimer_unregister(chron_timer_t* timer);
+
+/* wheel.c */
+
+void __el_release(chron_tw_slot_el_t* el);
+
+void __el_hold(chron_tw_slot_el_t* el);
+
+void __el_unhold(chron_tw_slot_el_t* el);
+
+bool __el_invoke(chron_tw_slot_el_t* el);
+
+void __el_cancel(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el);
+
+/* pool.c */
+
+bool __pool_init(chron_timer_wheel_t* tw, int n_workers);
+
+bool __pool_start(chron_timer_wheel_t* tw);
+
+void __pool_stop(chron_timer_wheel_t* tw);
+
+void __pool_destroy(chron_timer_wheel_t* tw);
+
+void __pool_submit(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el, uint64_t deadline_ns);
+
+/* histogram.c */
+
+bool __latency_init(chron_timer_wheel_t* tw);
+
+void __latency_destroy(chron_timer_wheel_t* tw);
+
+void __latency_record(chron_timer_wheel_t* tw, chron_tw_latency which, uint64_t ns);
+
+/* heap.c */
+
+bool __tw_heap_init(chron_timer_wheel_t* tw, unsigned long prealloc);
+
+void __tw_heap_destroy(chron_timer_wheel_t* tw);
+
+chron_tw_slot* __tw_heap_slot(chron_timer_wheel_t* tw);
+
+bool __tw_heap_reserve(chron_timer_wheel_t* tw, unsigned long n);
+
+void __tw_heap_unreserve(chron_timer_wheel_t* tw);
+
+void __tw_heap_push(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el);
+
+void __tw_heap_remove(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el);
+
+chron_tw_slot_el_t* __tw_heap_peek(chron_timer_wheel_t* tw);
+
+void __tw_heap_rebase(chron_timer_wheel_t* tw, uint64_t ticks);
+
+/* array.c */
+
+bool __tw_array_append(chron_tw_slot* slot, chron_tw_slot_el_t* el);
+
+bool __tw_array_remove(chron_tw_slot* slot, chron_tw_slot_el_t* el);
+
+chron_tw_slot_el_t* __tw_array_first(chron_tw_slot* slot);
+
+void __tw_array_destroy(chron_timer_wheel_t* tw, int n_slots);
+
+/* slab.c */
+
+bool __slab_init(chron_timer_wheel_t* tw, unsigned long prealloc);
+
+void __slab_destroy(chron_timer_wheel_t* tw);
+
+chron_tw_slot_el_t* __slab_alloc(chron_timer_wheel_t* tw);
+
+bool __slab_alloc_batch(chron_timer_wheel_t* tw, chron_tw_slot_el_t** els, int n);
+
+void __slab_free(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el);
+
+#endif /* LIB_CHRON_INTERNAL_H */
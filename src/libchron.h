@@ -7,8 +7,10 @@
 #include <time.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdbool.h>
 #include <memory.h>
+#include <stdatomic.h>
 
 #include <pthread.h>
 
@@ -26,6 +28,52 @@ typedef enum {
 	TIMER_RESUMED
 } chron_timer_state;
 
+/**
+ * @brief Mechanism by which a timer is armed and its expirations delivered
+ */
+typedef enum {
+	/* a POSIX timer per chron_timer, each expiration delivered on a SIGEV_THREAD thread */
+	TIMER_BACKEND_POSIX,
+	/* every chron_timer multiplexed onto a single timerfd, delivered by one epoll dispatcher thread */
+	TIMER_BACKEND_TIMERFD,
+	/* every chron_timer a virtual timer, i.e. an event on a single shared timer wheel of
+	1ms ticks, delivered by the wheel thread; no kernel timer is created per chron_timer */
+	TIMER_BACKEND_WHEEL
+} chron_timer_backend;
+
+/**
+ * @brief Counters describing the activity of every chron_timer
+ */
+typedef struct chron_timer_stats {
+	/* timers initialized */
+	uint64_t n_created;
+
+	/* timers started */
+	uint64_t n_started;
+
+	/* timers rescheduled or restarted */
+	uint64_t n_rescheduled;
+
+	/* timers cancelled */
+	uint64_t n_cancelled;
+
+	/* timers deleted */
+	uint64_t n_deleted;
+
+	/* callbacks invoked */
+	uint64_t n_fired;
+
+	/* periodic expirations skipped because the previous one was still being delivered */
+	uint64_t n_missed;
+
+	/* TIMER_BACKEND_TIMERFD timers currently armed */
+	uint64_t n_armed;
+
+	/* kernel timers programmed: timer_settime calls for TIMER_BACKEND_POSIX,
+	and timerfd_settime calls of the shared dispatcher for TIMER_BACKEND_TIMERFD */
+	uint64_t n_settime;
+} chron_timer_stats_t;
+
 /**
  * @brief Represents a compound timer
  */
@@ -55,7 +103,7 @@ typedef struct chron_timer {
 	unsigned long time_remaining;
 
 	/* Counts callback invocations */
-	uint32_t invocation_count;
+	_Atomic uint32_t invocation_count;
 
 	/* Expiration time */
 	struct itimerspec ts;
@@ -63,12 +111,92 @@ typedef struct chron_timer {
 	/* Time val for exponent p*/
 	unsigned long exponential_backoff_time;
 
-	/* Current state of timer */
-	chron_timer_state timer_state;
+	/* Current state of timer (a chron_timer_state), updated only by compare-and-swap;
+	while a thread applies a transition it holds the timer, and the fields above
+	are its to write. A timer is held only while its fields are written, never
+	across a kernel timer call; operations on a held timer wait for it to be released */
+	_Atomic int timer_state;
+
+	/* Mechanism by which the timer is armed */
+	chron_timer_backend backend;
+
+	/* CLOCK_MONOTONIC deadline of the expiration for which the timer was last
+	armed in ns, 0 if disarmed, and its period in ns, 0 if one-shot; written by
+	the thread holding the timer, read under `deadline_seq` */
+	_Atomic uint64_t armed_deadline_ns;
+
+	_Atomic uint64_t armed_period_ns;
+
+	/* seqlock over `armed_deadline_ns` and `armed_period_ns`; odd while they are being written */
+	_Atomic uint32_t deadline_seq;
+
+	/* set while a thread programs the kernel timer for the recorded deadline */
+	atomic_bool is_syncing;
+
+	/* `deadline_seq` as of the deadline the kernel timer was last programmed for */
+	uint32_t synced_seq;
+
+	/* TIMER_BACKEND_TIMERFD: CLOCK_MONOTONIC deadline of the next expiration in ns */
+	uint64_t deadline_ns;
+
+	/* TIMER_BACKEND_TIMERFD: period in ns, 0 if the timer is one-shot */
+	uint64_t period_ns;
+
+	/* TIMER_BACKEND_TIMERFD: how late past its deadline an expiration may be
+	delivered, in ns, so that it may share a wakeup with others */
+	uint64_t slack_ns;
+
+	/* TIMER_BACKEND_TIMERFD: position in the dispatcher's heap, -1 if disarmed */
+	int heap_idx;
+
+	/* TIMER_BACKEND_WHEEL: the timer's event on the shared wheel, registered with the timer */
+	struct tw_slot_el* vtimer_el;
+
+	/* TIMER_BACKEND_WHEEL: CLOCK_MONOTONIC deadline in ns for which the event must
+	next fire, 0 if disarmed, and the period in ns, 0 if one-shot */
+	_Atomic uint64_t vtimer_deadline_ns;
+
+	_Atomic uint64_t vtimer_period_ns;
 } chron_timer_t;
 
 /* Hierarchical Timer Wheel */
 
+/* nanoseconds per unit, for use as a wheel's resolution */
+#define CHRON_NS_PER_S 1000000000L
+
+#define CHRON_NS_PER_MS 1000000L
+
+#define CHRON_NS_PER_US 1000L
+
+/* largest callback argument, in bytes, that may be copied into an event; see
+chron_timer_wheel_register_ev_inline. Define at build time to override */
+#ifndef CHRON_TW_INLINE_ARG_MAX
+#define CHRON_TW_INLINE_ARG_MAX 32
+#endif
+
+/* number of levels in the wheel; level 0 is the innermost (finest) ring */
+#define CHRON_TW_N_LEVELS 5
+
+/* log2 of the number of slots in each of the outer levels */
+#define CHRON_TW_LEVEL_BITS 6
+
+/* number of slots in each of the outer levels */
+#define CHRON_TW_LEVEL_SIZE (1 << CHRON_TW_LEVEL_BITS)
+
+/**
+ * @brief Structure in which a timer wheel keeps its scheduled events
+ */
+typedef enum {
+	/* the hierarchical wheel of slots; O(1) operations, suited to many events */
+	TW_BACKEND_WHEEL,
+	/* a 4-ary min-heap; O(log n) operations that never touch empty slots, suited to
+	few events with widely varying intervals */
+	TW_BACKEND_HEAP,
+	/* the hierarchical wheel, each slot an array rather than a linked list; suited to
+	very many events per slot, which then expire and cascade with a sequential scan */
+	TW_BACKEND_ARRAY
+} chron_tw_backend;
+
 typedef enum {
 	TW_CREATE,
 	TW_RESCHEDULED,
@@ -82,92 +210,501 @@ typedef enum {
  */
 typedef void (*chron_tw_callback)(void* arg, int arg_size);
 
+/**
+ * @brief Timer wheel callback invoked once per tick with the args of every
+ * event registered with it that came due at that tick
+ */
+typedef void (*chron_tw_batch_callback)(void** args, int n_args);
+
 /**
  * @brief Represents a single slot on the ring buffer
  */
 typedef struct ring_buffer_slot {
 	glthread_t linked_list;
+
+	/* last node of the slot's linked list; elements are appended so a slot fires in FIFO order */
+	glthread_t* tail;
+
 	pthread_mutex_t mutex;
+
+	/* number of elements in the slot; written only under `mutex` */
+	atomic_uint n_els;
+
+	/* TW_BACKEND_ARRAY: the slot's elements in the order they were appended, from
+	`array_head` to `array_len`; an element removed from the middle leaves a NULL
+	hole. Elements for which no room could be made are kept in `linked_list` */
+	struct tw_slot_el** array_els;
+
+	unsigned long array_head;
+
+	unsigned long array_len;
+
+	unsigned long array_capacity;
+
+	/* number of elements in `array_els`, not counting holes */
+	unsigned long array_n_live;
 } chron_tw_slot;
 
 /**
  * @brief Represents a single element in a slot on the ring buffer.
  */
 typedef struct tw_slot_el {
+	/* state of the el as last applied by the wheel */
 	chron_tw_opcode opcode;
 
 	/* interval after which the event needs to be invoked */
 	int interval;
 
-	int new_interval;
+	/* how much later than `interval` the event may be invoked, so as to share a tick with others */
+	int slack;
+
+	/* most recently requested operation (opcode and interval) not yet applied by the wheel */
+	_Atomic uint64_t pending;
+
+	/* tick at which the event is next due, as last requested by a producer or
+	re-armed by the wheel; 0 once it is unregistered. Readable from any thread */
+	_Atomic uint64_t due_tick;
+
+	/* CLOCK_MONOTONIC time at which the pending operation was requested, in ns; only if latency is tracked */
+	_Atomic uint64_t pending_ns;
+
+	/* set while the el sits in the wheel's submission queue */
+	atomic_bool is_queued;
+
+	/* next el in the wheel's submission queue */
+	struct tw_slot_el* next_submission;
 
-	/* revolution number at which the element's event must be invoked */
-	int r;
+	/* absolute tick at which the element's event must be invoked */
+	uint64_t expires;
 
-	/* numeric identifier of the slot to which this el belongs */
+	/* wheel level in which the el currently resides */
+	int level;
+
+	/* numeric identifier of the slot (within its level) to which this el belongs */
 	int slot_n;
 
+	/* position of the el in its slot's array, in a TW_BACKEND_ARRAY wheel */
+	unsigned long array_idx;
+
+	/* position of the el in the heap of a TW_BACKEND_HEAP wheel */
+	unsigned long heap_idx;
+
+	/* order in which the el was placed in the heap, breaking ties between equal deadlines */
+	uint64_t heap_seq;
+
 	/* the event callback */
 	chron_tw_callback callback;
 
+	/* the callback with which the event is invoked alongside others due at the same tick, instead of `callback` */
+	chron_tw_batch_callback batch_callback;
+
 	/* the event callback argument */
 	void* callback_arg;
 
 	/* the event callback argument size */
 	int arg_size;
 
+	/* storage for a callback argument copied into the el, to which `callback_arg` then points */
+	_Alignas(max_align_t) unsigned char inline_arg[CHRON_TW_INLINE_ARG_MAX];
+
 	/* is the event recurring? i.e. if 1, the event must be triggered at ea interval */
 	int is_recurring;
 
 	/* el's linked list node delegate */
 	glthread_t linked_list_node;
 
-	glthread_t waitlist_node;
-
-	/* pointer to the head node address of the slot to which this el belongs */
-	chron_tw_slot* slot_head;
+	/* pointer to the head node address of the slot to which this el belongs;
+	only changed under that slot's mutex */
+	_Atomic(chron_tw_slot*) slot_head;
 
 	/* counter of how many times this el has been scheduled */
 	unsigned int n_scheduled;
+
+	/* references held on the el: one by the wheel until it is unregistered, one per pending submission and queued callback */
+	atomic_int refs;
+
+	/* set once the el is unregistered; its callback is never invoked thereafter */
+	atomic_bool is_deleted;
+
+	/* number of threads holding the el outside of any slot, e.g. while
+	invoking its callback; unregistering waits for this to drop */
+	atomic_int n_busy;
+
+	/* identifies the thread about to invoke the el's batch callback, while it holds the el for that */
+	_Atomic(const void*) batch_owner;
+
+	/* el whose unregistering the el's callback is waiting on, if any */
+	_Atomic(struct tw_slot_el*) waiting_on;
+
+	/* index of the worker on which the el's callbacks run, in pool dispatch mode */
+	int worker;
+
+	/* the wheel on which the el is registered */
+	struct timer_wheel* tw;
 } chron_tw_slot_el_t;
 
+/**
+ * @brief Describes an event to be registered in bulk
+ */
+typedef struct chron_tw_ev_desc {
+	chron_tw_callback callback;
+
+	void* arg;
+
+	int arg_size;
+
+	int interval;
+
+	int recurring;
+
+	/* how much later than `interval` the event may fire; see chron_timer_wheel_register_ev_slack */
+	int slack;
+
+	/* whether to copy `arg` into the event; see chron_timer_wheel_register_ev_inline */
+	bool is_arg_inline;
+
+	/* if set, used in place of `callback`; see chron_timer_wheel_register_ev_batched */
+	chron_tw_batch_callback batch_callback;
+} chron_tw_ev_desc_t;
+
+/**
+ * @brief An el due at the tick being processed whose batch callback is deferred
+ * to the end of the tick
+ */
+typedef struct chron_tw_batch_entry {
+	chron_tw_slot_el_t* el;
+
+	/* order in which the el came due, so each batch lists its args in that order */
+	unsigned long seq;
+} chron_tw_batch_entry_t;
+
+/**
+ * @brief Latency breakdown of the callbacks run by a timer wheel's worker pool
+ */
+typedef struct chron_tw_pool_stats {
+	/* callbacks currently queued */
+	unsigned long queue_depth;
+
+	/* callbacks handed to the pool */
+	unsigned long n_dispatched;
+
+	/* callbacks that ran to completion */
+	unsigned long n_completed;
+
+	/* callbacks run inline on the wheel thread, as their worker's queue could not grow */
+	unsigned long n_inline;
+
+	/* time spent queued between expiry and the callback starting, in ns */
+	uint64_t wait_ns_total;
+
+	uint64_t wait_ns_max;
+
+	/* time spent executing the callback, in ns */
+	uint64_t exec_ns_total;
+
+	uint64_t exec_ns_max;
+} chron_tw_pool_stats_t;
+
+/**
+ * @brief Latencies a timer wheel can record
+ */
+typedef enum {
+	/* how late each callback started relative to the tick at which its event was due */
+	CHRON_TW_LATENCY_LATENESS,
+	/* how long each callback ran */
+	CHRON_TW_LATENCY_EXEC,
+	/* how long each register or reschedule waited before the wheel applied it */
+	CHRON_TW_LATENCY_SUBMIT,
+	CHRON_TW_N_LATENCIES
+} chron_tw_latency;
+
+/* every power of two is split into 2^CHRON_TW_HIST_SUB_BITS buckets, bounding
+the relative error of a recorded latency to 1/32 */
+#define CHRON_TW_HIST_SUB_BITS 5
+
+/* latencies of 2^CHRON_TW_HIST_MAX_BITS ns (about 18 minutes) or more share the last bucket */
+#define CHRON_TW_HIST_MAX_BITS 40
+
+#define CHRON_TW_HIST_N_BUCKETS \
+	((CHRON_TW_HIST_MAX_BITS - CHRON_TW_HIST_SUB_BITS + 1) << CHRON_TW_HIST_SUB_BITS)
+
+/**
+ * @brief Snapshot of a log-linear latency histogram
+ */
+typedef struct chron_tw_histogram {
+	uint64_t counts[CHRON_TW_HIST_N_BUCKETS];
+
+	/* number of samples */
+	uint64_t n;
+
+	uint64_t sum_ns;
+
+	uint64_t max_ns;
+} chron_tw_histogram_t;
+
+/**
+ * @brief Counters describing a timer wheel's activity
+ */
+typedef struct chron_tw_stats {
+	/* events registered */
+	uint64_t n_scheduled;
+
+	/* events rescheduled */
+	uint64_t n_rescheduled;
+
+	/* events unregistered */
+	uint64_t n_cancelled;
+
+	/* callbacks invoked, or handed to the worker pool */
+	uint64_t n_fired;
+
+	/* events currently registered */
+	uint64_t n_events;
+
+	/* register, reschedule and unregister requests not yet applied by the wheel */
+	uint64_t waitlist_depth;
+
+	/* number of events in the fullest slot; for TW_BACKEND_HEAP, in the heap */
+	uint64_t max_slot_len;
+
+	/* ticks processed; ticks at which nothing was due are skipped and not counted */
+	uint64_t n_ticks;
+
+	/* how late ticks were processed, in ticks, summed over every tick processed
+	a full tick or more after it was due */
+	uint64_t n_ticks_missed;
+} chron_tw_stats_t;
+
+typedef struct chron_tw_worker chron_tw_worker_t;
+
+typedef struct chron_tw_latency chron_tw_latency_t;
+
+typedef struct chron_tw_slab chron_tw_slab_t;
+
+typedef struct chron_tw_heap chron_tw_heap_t;
+
+/**
+ * @brief Timer wheel configuration
+ */
+typedef struct chron_tw_opts {
+	/* number of level 0 slots */
+	int size;
+
+	/* tick interval, expressed in units of `resolution_ns` */
+	int tick_interval;
+
+	/* length of one interval unit in ns; event intervals are expressed in the same unit. 0 defaults to 1s */
+	long resolution_ns;
+
+	/* number of worker threads on which callbacks run; 0 runs them inline on the wheel thread */
+	int n_workers;
+
+	/* number of events for which memory is allocated up front */
+	unsigned long prealloc;
+
+	/* whether to record latency histograms; see chron_timer_wheel_get_latency */
+	bool track_latency;
+
+	/* whether to pin the wheel thread to `cpu` */
+	bool is_pinned;
+
+	int cpu;
+
+	/* whether the wheel runs without a thread, its clock driven by the caller
+	through chron_timer_wheel_advance; callbacks then run on the caller's thread */
+	bool is_manual;
+
+	/* whether the wheel runs without a thread, its due events run by the caller
+	through chron_timer_wheel_process whenever chron_timer_wheel_get_fd is readable */
+	bool is_pollable;
+
+	/* structure in which events are kept; `size` is ignored by TW_BACKEND_HEAP */
+	chron_tw_backend backend;
+} chron_tw_opts_t;
+
 /**
  * @brief Represents a Hierarchical Timer Wheel
+ *
+ * Level 0 holds `ring_size` slots of one tick each. Every outer level k holds
+ * CHRON_TW_LEVEL_SIZE slots, each spanning a full revolution of level k - 1.
+ * Events are placed in the finest level that can hold their deadline and are
+ * cascaded inward as the coarser slots come due.
  */
 typedef struct timer_wheel {
-	/* current tick and also the slot number currently pointed to */
+	/* current tick and also the slot number currently pointed to in level 0 */
 	int current_tick;
 
-	/* tick interval e.g. 1ms, 1s, 1m... */
+	/* tick interval e.g. 1ms, 1s, 1m..., in units of `resolution_ns` */
 	int tick_interval;
 
-	/* number of slots in the wheel */
+	/* length of one interval unit in ns */
+	long resolution_ns;
+
+	/* length of a single tick in ns */
+	uint64_t tick_ns;
+
+	/* number of slots in level 0 of the wheel */
 	int ring_size;
 
-	/* aka R; the number of full revolutions completed */
+	/* aka R; the number of full revolutions of level 0 completed */
 	int n_revolutions;
 
+	/* absolute number of ticks elapsed since the wheel routine began */
+	_Atomic uint64_t abs_tick;
+
 	/* the thread on which the wheel is invoked */
 	pthread_t thread;
 
-	/* slots holding linked lists */
-	chron_tw_slot slots[0];
+	/* CPU to which the wheel thread is pinned, or -1 */
+	int cpu;
+
+	/* CLOCK_MONOTONIC time at which the wheel was started; tick n is due at epoch + n * tick_ns */
+	struct timespec epoch;
+
+	/* cleared to ask the wheel thread to exit */
+	atomic_bool is_running;
+
+	/* whether the wheel's clock is driven by the caller rather than a thread */
+	bool is_manual;
+
+	/* whether the wheel's events are run by the caller when `fd` is readable, rather than by a thread */
+	bool is_pollable;
+
+	/* timerfd armed for the tick at which a pollable wheel next needs processing, or -1 */
+	int fd;
+
+	/* number of workers in the callback pool, 0 if callbacks run inline */
+	int n_workers;
+
+	/* the callback pool, if any */
+	chron_tw_worker_t* workers;
+
+	/* round-robin counter by which els are assigned a worker */
+	atomic_uint next_worker;
+
+	/* allocator from which the wheel's els are drawn */
+	chron_tw_slab_t* slab;
+
+	/* the heap in which events are kept instead of `slots`, if TW_BACKEND_HEAP */
+	chron_tw_heap_t* heap;
+
+	/* whether each slot keeps its events in its array, if TW_BACKEND_ARRAY */
+	bool is_array;
+
+	/* latency histograms, or NULL if not tracked */
+	chron_tw_latency_t* latency;
+
+	/* els with a batch callback due at the tick being processed, and scratch
+	space for their args; used only by the thread advancing the wheel */
+	chron_tw_batch_entry_t* batch;
+
+	void** batch_args;
 
-	chron_tw_slot waitlist;
+	unsigned long batch_len;
 
-	/* total number of slots in the wheel */
-	unsigned int n_slots;
+	unsigned long batch_capacity;
+
+	/* lock-free stack of els with pending operations, drained by the wheel thread */
+	_Atomic(chron_tw_slot_el_t*) submissions;
+
+	/* bitmap of non-empty slots, one bit per slot in the order of `slots` */
+	_Atomic uint64_t* occupancy;
+
+	/* tick at which the idle wheel thread next intends to wake, or for which a
+	pollable wheel's `fd` is armed; 0 while either is processing */
+	_Atomic uint64_t next_wake_tick;
+
+	/* protects `is_woken`; the idle wheel thread waits on `idle_cond` */
+	pthread_mutex_t idle_mutex;
+
+	pthread_cond_t idle_cond;
+
+	/* unregistering a held el waits on `unheld_cond`, which is broadcast
+	whenever a thread lets go of an unregistered el */
+	pthread_mutex_t unheld_mutex;
+
+	pthread_cond_t unheld_cond;
+
+	/* set to wake the idle wheel thread early */
+	bool is_woken;
+
+	/* total number of events registered in the wheel */
+	atomic_uint n_slots;
+
+	/* counters reported by chron_timer_wheel_get_stats. Only the wheel thread
+	writes them, except `n_scheduled`, `n_cancelled` and `n_waiting`, which
+	producers increment */
+	_Atomic uint64_t n_scheduled;
+
+	_Atomic uint64_t n_rescheduled;
+
+	_Atomic uint64_t n_cancelled;
+
+	_Atomic uint64_t n_fired;
+
+	_Atomic uint64_t n_ticks;
+
+	_Atomic uint64_t n_ticks_missed;
+
+	/* number of operations in the submission queue */
+	_Atomic uint64_t n_waiting;
+
+	/* slots holding linked lists; level 0 first, followed by each outer level */
+	chron_tw_slot slots[];
 } chron_timer_wheel_t;
 
+/**
+ * @brief A set of independent timer wheels, or shards, each with its own tick
+ * thread and submission queue. Events are registered on the shard local to the
+ * calling CPU, so producers on different CPUs never contend on the same wheel.
+ */
+typedef struct chron_sharded_wheel {
+	int n_shards;
+
+	chron_timer_wheel_t** shards;
+} chron_sharded_wheel_t;
+
 /* Methods */
 
 chron_timer_wheel_t* chron_timer_wheel_init(int size, int tick_interval);
 
+chron_timer_wheel_t* chron_timer_wheel_init_opts(const chron_tw_opts_t* opts);
+
 bool chron_timer_wheel_start(chron_timer_wheel_t* tw);
 
+void chron_timer_wheel_stop(chron_timer_wheel_t* tw);
+
+void chron_timer_wheel_destroy(chron_timer_wheel_t* tw);
+
+bool chron_timer_wheel_get_pool_stats(
+	chron_timer_wheel_t* tw,
+	int worker,
+	chron_tw_pool_stats_t* stats
+);
+
+void chron_timer_wheel_get_stats(chron_timer_wheel_t* tw, chron_tw_stats_t* stats);
+
+bool chron_timer_wheel_get_latency(
+	chron_timer_wheel_t* tw,
+	chron_tw_latency which,
+	chron_tw_histogram_t* hist
+);
+
+uint64_t chron_tw_histogram_percentile(const chron_tw_histogram_t* hist, double percentile);
+
 int chron_timer_wheel_get_time_remaining(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el);
 
-void chron_timer_wheel_reset(chron_timer_wheel_t* tw);
+int64_t chron_timer_wheel_get_ns_remaining(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el);
+
+bool chron_timer_wheel_reset(chron_timer_wheel_t* tw);
+
+int chron_timer_wheel_get_fd(chron_timer_wheel_t* tw);
+
+uint64_t chron_timer_wheel_process(chron_timer_wheel_t* tw);
+
+uint64_t chron_timer_wheel_advance(chron_timer_wheel_t* tw, uint64_t ticks);
+
+uint64_t chron_timer_wheel_advance_to(chron_timer_wheel_t* tw, uint64_t time);
 
 void chron_timer_wheel_reschedule_ev(
 	chron_timer_wheel_t* tw,
@@ -189,6 +726,86 @@ chron_tw_slot_el_t* chron_timer_wheel_register_ev(
 	int recurring
 );
 
+chron_tw_slot_el_t* chron_timer_wheel_register_ev_slack(
+	chron_timer_wheel_t* tw,
+	chron_tw_callback callback,
+	void* arg,
+	int arg_size,
+	int interval,
+	int slack,
+	int recurring
+);
+
+chron_tw_slot_el_t* chron_timer_wheel_register_ev_inline(
+	chron_timer_wheel_t* tw,
+	chron_tw_callback callback,
+	const void* arg,
+	int arg_size,
+	int interval,
+	int recurring
+);
+
+chron_tw_slot_el_t* chron_timer_wheel_register_ev_batched(
+	chron_timer_wheel_t* tw,
+	chron_tw_batch_callback batch_callback,
+	void* arg,
+	int arg_size,
+	int interval,
+	int recurring
+);
+
+bool chron_timer_wheel_register_batch(
+	chron_timer_wheel_t* tw,
+	const chron_tw_ev_desc_t* descs,
+	int n,
+	chron_tw_slot_el_t** els
+);
+
+void chron_timer_wheel_unregister_batch(
+	chron_timer_wheel_t* tw,
+	chron_tw_slot_el_t** els,
+	int n
+);
+
+chron_sharded_wheel_t* chron_sharded_wheel_init(int n_shards, const chron_tw_opts_t* opts);
+
+bool chron_sharded_wheel_start(chron_sharded_wheel_t* sw);
+
+void chron_sharded_wheel_stop(chron_sharded_wheel_t* sw);
+
+void chron_sharded_wheel_destroy(chron_sharded_wheel_t* sw);
+
+int chron_sharded_wheel_get_local_shard(chron_sharded_wheel_t* sw);
+
+chron_tw_slot_el_t* chron_sharded_wheel_register_ev(
+	chron_sharded_wheel_t* sw,
+	chron_tw_callback callback,
+	void* arg,
+	int arg_size,
+	int interval,
+	int recurring
+);
+
+chron_tw_slot_el_t* chron_sharded_wheel_register_ev_on(
+	chron_sharded_wheel_t* sw,
+	int shard,
+	chron_tw_callback callback,
+	void* arg,
+	int arg_size,
+	int interval,
+	int recurring
+);
+
+void chron_sharded_wheel_reschedule_ev(
+	chron_sharded_wheel_t* sw,
+	chron_tw_slot_el_t* el,
+	int next_interval
+);
+
+void chron_sharded_wheel_unregister_ev(chron_sharded_wheel_t* sw, chron_tw_slot_el_t* el);
+
+void chron_timer_set_backend(chron_timer_backend backend);
+
 chron_timer_t* chron_timer_init(
 	void (*callback)(chron_timer_t* timer, void* arg),
 	void* callback_arg,
@@ -222,4 +839,8 @@ bool chron_timer_reschedule(
 
 bool chron_timer_delete(chron_timer_t* timer);
 
+bool chron_timer_set_slack(chron_timer_t* timer, unsigned long slack_ms);
+
+void chron_timer_get_stats(chron_timer_stats_t* stats);
+
 #endif /* LIB_CHRON_H */
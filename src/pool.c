@@ -0,0 +1,329 @@
+#include "internal.h"
+
+/**
+ * @brief A callback queued on a worker
+ */
+typedef struct chron_tw_job {
+	chron_tw_slot_el_t* el;
+
+	/* CLOCK_MONOTONIC time at which the job was queued, in ns */
+	uint64_t queued_ns;
+
+	/* CLOCK_MONOTONIC time at which the el was due, in ns; only if latency is tracked */
+	uint64_t deadline_ns;
+} chron_tw_job_t;
+
+/**
+ * @brief A worker thread of a timer wheel's callback pool. Each worker runs
+ * its jobs strictly in the order they were queued.
+ */
+struct chron_tw_worker {
+	pthread_t thread;
+
+	pthread_mutex_t mutex;
+
+	pthread_cond_t cond;
+
+	/* circular buffer of queued jobs */
+	chron_tw_job_t* jobs;
+
+	unsigned long head;
+
+	unsigned long n_jobs;
+
+	unsigned long capacity;
+
+	/* set to ask the worker to exit once its queue is drained */
+	bool is_stopping;
+
+	chron_tw_pool_stats_t stats;
+};
+
+/* HELPERS */
+
+/**
+ * @brief Opaque helper. Get the current CLOCK_MONOTONIC time in ns
+ *
+ * @return uint64_t
+ */
+uint64_t __pool_now_ns(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * CHRON_NS_PER_S + now.tv_nsec;
+}
+
+/**
+ * @brief Opaque helper. Append a job to the worker's queue, growing it as
+ * necessary. The caller must hold the worker's mutex.
+ *
+ * @param worker
+ * @param job
+ * @return bool
+ */
+bool __worker_push(chron_tw_worker_t* worker, chron_tw_job_t job) {
+	if (worker->n_jobs == worker->capacity) {
+		unsigned long capacity = worker->capacity ? worker->capacity * 2 : 256;
+		chron_tw_job_t* jobs = malloc(capacity * sizeof(chron_tw_job_t));
+
+		if (!jobs) return false;
+
+		// unwrap the circular buffer into the new allocation
+		for (unsigned long i = 0; i < worker->n_jobs; i++) {
+			jobs[i] = worker->jobs[(worker->head + i) % worker->capacity];
+		}
+
+		free(worker->jobs);
+
+		worker->jobs = jobs;
+		worker->head = 0;
+		worker->capacity = capacity;
+	}
+
+	worker->jobs[(worker->head + worker->n_jobs) % worker->capacity] = job;
+	worker->n_jobs++;
+
+	return true;
+}
+
+/**
+ * @brief Opaque helper. The thread routine on which a worker runs callbacks
+ *
+ * @param arg
+ * @return void*
+ */
+void* __worker_routine(void* arg) {
+	chron_tw_worker_t* worker = (chron_tw_worker_t*)arg;
+	chron_tw_job_t job;
+	uint64_t start_ns;
+	uint64_t end_ns;
+
+	pthread_mutex_lock(&worker->mutex);
+
+	while (true) {
+		while (!worker->n_jobs && !worker->is_stopping) {
+			pthread_cond_wait(&worker->cond, &worker->mutex);
+		}
+
+		if (!worker->n_jobs) break;
+
+		job = worker->jobs[worker->head];
+		worker->head = (worker->head + 1) % worker->capacity;
+		worker->n_jobs--;
+		worker->stats.queue_depth = worker->n_jobs;
+
+		pthread_mutex_unlock(&worker->mutex);
+
+		start_ns = __pool_now_ns();
+
+		// the el may have been unregistered while its callback was queued
+		__el_hold(job.el);
+		bool is_run = __el_invoke(job.el);
+		__el_unhold(job.el);
+
+		end_ns = __pool_now_ns();
+
+		if (is_run && job.el->tw->latency) {
+			__latency_record(
+				job.el->tw,
+				CHRON_TW_LATENCY_LATENESS,
+				start_ns > job.deadline_ns ? start_ns - job.deadline_ns : 0
+			);
+			__latency_record(job.el->tw, CHRON_TW_LATENCY_EXEC, end_ns - start_ns);
+		}
+
+		__el_release(job.el);
+
+		pthread_mutex_lock(&worker->mutex);
+
+		worker->stats.n_completed++;
+		worker->stats.wait_ns_total += start_ns - job.queued_ns;
+		worker->stats.exec_ns_total += end_ns - start_ns;
+
+		if (start_ns - job.queued_ns > worker->stats.wait_ns_max) {
+			worker->stats.wait_ns_max = start_ns - job.queued_ns;
+		}
+
+		if (end_ns - start_ns > worker->stats.exec_ns_max) {
+			worker->stats.exec_ns_max = end_ns - start_ns;
+		}
+	}
+
+	pthread_mutex_unlock(&worker->mutex);
+
+	return NULL;
+}
+
+/* INTERNAL API */
+
+/**
+ * @brief Allocate a wheel's callback pool; its threads are started with the wheel
+ *
+ * @param tw
+ * @param n_workers
+ * @return bool
+ */
+bool __pool_init(chron_timer_wheel_t* tw, int n_workers) {
+	tw->n_workers = 0;
+	tw->workers = NULL;
+
+	if (n_workers <= 0) return true;
+
+	tw->workers = calloc(n_workers, sizeof(chron_tw_worker_t));
+	if (!tw->workers) return false;
+
+	for (int i = 0; i < n_workers; i++) {
+		pthread_mutex_init(&tw->workers[i].mutex, NULL);
+		pthread_cond_init(&tw->workers[i].cond, NULL);
+	}
+
+	tw->n_workers = n_workers;
+
+	return true;
+}
+
+/**
+ * @brief Start the pool's worker threads
+ *
+ * @param tw
+ * @return bool
+ */
+bool __pool_start(chron_timer_wheel_t* tw) {
+	for (int i = 0; i < tw->n_workers; i++) {
+		chron_tw_worker_t* worker = &tw->workers[i];
+
+		worker->is_stopping = false;
+
+		if (pthread_create(&worker->thread, NULL, __worker_routine, (void*)worker)) {
+			// unwind the workers that did start
+			while (i--) {
+				pthread_mutex_lock(&tw->workers[i].mutex);
+				tw->workers[i].is_stopping = true;
+				pthread_cond_signal(&tw->workers[i].cond);
+				pthread_mutex_unlock(&tw->workers[i].mutex);
+
+				pthread_join(tw->workers[i].thread, NULL);
+			}
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief Stop the pool's worker threads once they have drained their queues
+ *
+ * @param tw
+ */
+void __pool_stop(chron_timer_wheel_t* tw) {
+	for (int i = 0; i < tw->n_workers; i++) {
+		pthread_mutex_lock(&tw->workers[i].mutex);
+		tw->workers[i].is_stopping = true;
+		pthread_cond_signal(&tw->workers[i].cond);
+		pthread_mutex_unlock(&tw->workers[i].mutex);
+	}
+
+	for (int i = 0; i < tw->n_workers; i++) {
+		pthread_join(tw->workers[i].thread, NULL);
+	}
+}
+
+/**
+ * @brief Free a stopped pool
+ *
+ * @param tw
+ */
+void __pool_destroy(chron_timer_wheel_t* tw) {
+	for (int i = 0; i < tw->n_workers; i++) {
+		pthread_mutex_destroy(&tw->workers[i].mutex);
+		pthread_cond_destroy(&tw->workers[i].cond);
+		free(tw->workers[i].jobs);
+	}
+
+	free(tw->workers);
+
+	tw->workers = NULL;
+	tw->n_workers = 0;
+}
+
+/**
+ * @brief Queue an expired el's callback on the el's worker. The job holds a
+ * reference to the el until the callback has run. Should the worker's queue
+ * fail to grow, the callback runs inline on the calling thread instead, which
+ * still holds the el, rather than the expiry being lost.
+ *
+ * @param tw
+ * @param el
+ * @param deadline_ns
+ */
+void __pool_submit(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el, uint64_t deadline_ns) {
+	chron_tw_worker_t* worker = &tw->workers[el->worker % tw->n_workers];
+	chron_tw_job_t job = { .el = el, .queued_ns = __pool_now_ns(), .deadline_ns = deadline_ns };
+
+	atomic_fetch_add(&el->refs, 1);
+
+	pthread_mutex_lock(&worker->mutex);
+
+	if (!__worker_push(worker, job)) {
+		worker->stats.n_inline++;
+		pthread_mutex_unlock(&worker->mutex);
+		__el_release(el);
+
+		__el_invoke(el);
+		return;
+	}
+
+	worker->stats.n_dispatched++;
+	worker->stats.queue_depth = worker->n_jobs;
+
+	// the worker only ever waits on an empty queue
+	if (worker->n_jobs == 1) {
+		pthread_cond_signal(&worker->cond);
+	}
+
+	pthread_mutex_unlock(&worker->mutex);
+}
+
+/* PUBLIC API */
+
+/**
+ * @brief Get the statistics of one worker of the wheel's callback pool,
+ * or of the whole pool if `worker` is negative
+ *
+ * @param tw
+ * @param worker
+ * @param stats
+ * @return bool false if the wheel has no pool or `worker` is out of range
+ */
+bool chron_timer_wheel_get_pool_stats(
+	chron_timer_wheel_t* tw,
+	int worker,
+	chron_tw_pool_stats_t* stats
+) {
+	if (!tw || !stats || !tw->n_workers || worker >= tw->n_workers) return false;
+
+	memset(stats, 0, sizeof(chron_tw_pool_stats_t));
+
+	for (int i = worker < 0 ? 0 : worker; i < (worker < 0 ? tw->n_workers : worker + 1); i++) {
+		chron_tw_worker_t* w = &tw->workers[i];
+
+		pthread_mutex_lock(&w->mutex);
+
+		stats->queue_depth += w->stats.queue_depth;
+		stats->n_dispatched += w->stats.n_dispatched;
+		stats->n_completed += w->stats.n_completed;
+		stats->n_inline += w->stats.n_inline;
+		stats->wait_ns_total += w->stats.wait_ns_total;
+		stats->exec_ns_total += w->stats.exec_ns_total;
+
+		if (w->stats.wait_ns_max > stats->wait_ns_max) stats->wait_ns_max = w->stats.wait_ns_max;
+		if (w->stats.exec_ns_max > stats->exec_ns_max) stats->exec_ns_max = w->stats.exec_ns_max;
+
+		pthread_mutex_unlock(&w->mutex);
+	}
+
+	return true;
+}
@@ -0,0 +1,220 @@
+#define _GNU_SOURCE
+
+#include "internal.h"
+
+#include <sched.h>
+#include <unistd.h>
+
+/* HELPERS */
+
+/**
+ * @brief Opaque helper. Get the number of online CPUs
+ *
+ * @return int
+ */
+int __shard_n_cpus(void) {
+	long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return n_cpus > 0 ? (int)n_cpus : 1;
+}
+
+/* PUBLIC API */
+
+/**
+ * @brief Initialize a sharded timer wheel. Shard `i` is configured per `opts`
+ * and has its thread pinned to CPU `i` modulo the number of online CPUs.
+ *
+ * @param n_shards number of shards; 0 creates one per online CPU
+ * @param opts configuration shared by every shard; its CPU fields are ignored
+ * @return chron_sharded_wheel_t*
+ */
+chron_sharded_wheel_t* chron_sharded_wheel_init(int n_shards, const chron_tw_opts_t* opts) {
+	int n_cpus = __shard_n_cpus();
+
+	if (!opts || n_shards < 0) return NULL;
+
+	if (!n_shards) n_shards = n_cpus;
+
+	chron_sharded_wheel_t* sw = calloc(1, sizeof(chron_sharded_wheel_t));
+	if (!sw) return NULL;
+
+	sw->shards = calloc(n_shards, sizeof(chron_timer_wheel_t*));
+	if (!sw->shards) {
+		free(sw);
+		return NULL;
+	}
+
+	for (int i = 0; i < n_shards; i++) {
+		chron_tw_opts_t shard_opts = *opts;
+
+		shard_opts.is_pinned = true;
+		shard_opts.cpu = i % n_cpus;
+
+		if (!(sw->shards[i] = chron_timer_wheel_init_opts(&shard_opts))) {
+			chron_sharded_wheel_destroy(sw);
+			return NULL;
+		}
+
+		sw->n_shards++;
+	}
+
+	return sw;
+}
+
+/**
+ * @brief Start every shard's thread
+ *
+ * @param sw
+ * @return bool false if any shard failed to start, in which case none are running
+ */
+bool chron_sharded_wheel_start(chron_sharded_wheel_t* sw) {
+	if (!sw) return false;
+
+	for (int i = 0; i < sw->n_shards; i++) {
+		if (!chron_timer_wheel_start(sw->shards[i])) {
+			while (i--) chron_timer_wheel_stop(sw->shards[i]);
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief Stop every shard's thread
+ *
+ * @param sw
+ */
+void chron_sharded_wheel_stop(chron_sharded_wheel_t* sw) {
+	if (!sw) return;
+
+	for (int i = 0; i < sw->n_shards; i++) {
+		chron_timer_wheel_stop(sw->shards[i]);
+	}
+}
+
+/**
+ * @brief Stop every shard and free the sharded wheel along with every event
+ * registered on it
+ *
+ * @param sw
+ */
+void chron_sharded_wheel_destroy(chron_sharded_wheel_t* sw) {
+	if (!sw) return;
+
+	for (int i = 0; i < sw->n_shards; i++) {
+		chron_timer_wheel_destroy(sw->shards[i]);
+	}
+
+	free(sw->shards);
+	free(sw);
+}
+
+/**
+ * @brief Get the index of the shard local to the CPU on which the caller is running
+ *
+ * @param sw
+ * @return int
+ */
+int chron_sharded_wheel_get_local_shard(chron_sharded_wheel_t* sw) {
+	int cpu = sched_getcpu();
+
+	return cpu < 0 ? 0 : cpu % sw->n_shards;
+}
+
+/**
+ * @brief Register a new event on the shard local to the calling CPU
+ *
+ * @param sw
+ * @param callback
+ * @param arg
+ * @param arg_size
+ * @param interval
+ * @param recurring
+ * @return chron_tw_slot_el_t*
+ */
+chron_tw_slot_el_t* chron_sharded_wheel_register_ev(
+	chron_sharded_wheel_t* sw,
+	chron_tw_callback callback,
+	void* arg,
+	int arg_size,
+	int interval,
+	int recurring
+) {
+	if (!sw) return NULL;
+
+	return chron_sharded_wheel_register_ev_on(
+		sw,
+		chron_sharded_wheel_get_local_shard(sw),
+		callback,
+		arg,
+		arg_size,
+		interval,
+		recurring
+	);
+}
+
+/**
+ * @brief Register a new event on the given shard
+ *
+ * @param sw
+ * @param shard
+ * @param callback
+ * @param arg
+ * @param arg_size
+ * @param interval
+ * @param recurring
+ * @return chron_tw_slot_el_t*
+ */
+chron_tw_slot_el_t* chron_sharded_wheel_register_ev_on(
+	chron_sharded_wheel_t* sw,
+	int shard,
+	chron_tw_callback callback,
+	void* arg,
+	int arg_size,
+	int interval,
+	int recurring
+) {
+	if (!sw || shard < 0 || shard >= sw->n_shards) return NULL;
+
+	return chron_timer_wheel_register_ev(
+		sw->shards[shard],
+		callback,
+		arg,
+		arg_size,
+		interval,
+		recurring
+	);
+}
+
+/**
+ * @brief Reschedule an event. The event stays on the shard on which it was
+ * registered; the request is pushed onto that shard's lock-free submission
+ * queue, so this is safe from any CPU.
+ *
+ * @param sw
+ * @param el
+ * @param next_interval
+ */
+void chron_sharded_wheel_reschedule_ev(
+	chron_sharded_wheel_t* sw,
+	chron_tw_slot_el_t* el,
+	int next_interval
+) {
+	if (!sw || !el) return;
+
+	chron_timer_wheel_reschedule_ev(el->tw, el, next_interval);
+}
+
+/**
+ * @brief Unregister an event, from whichever shard it was registered on
+ *
+ * @param sw
+ * @param el
+ */
+void chron_sharded_wheel_unregister_ev(chron_sharded_wheel_t* sw, chron_tw_slot_el_t* el) {
+	if (!sw || !el) return;
+
+	chron_timer_wheel_unregister_ev(el->tw, el);
+}
@@ -0,0 +1,366 @@
+#include "internal.h"
+
+/* number of els carved out of each chunk */
+#define CHRON_TW_SLAB_CHUNK_SIZE 256
+
+/* number of els a thread-local cache holds before returning a batch to the depot */
+#define CHRON_TW_SLAB_CACHE_MAX 128
+
+/* number of els moved between a thread-local cache and the depot at once */
+#define CHRON_TW_SLAB_BATCH 64
+
+/**
+ * @brief A contiguous block of els
+ */
+typedef struct chron_tw_slab_chunk {
+	struct chron_tw_slab_chunk* next;
+
+	chron_tw_slot_el_t els[];
+} chron_tw_slab_chunk_t;
+
+/**
+ * @brief A thread's private free list of els for a given wheel
+ */
+typedef struct chron_tw_slab_cache {
+	chron_tw_slab_t* slab;
+
+	/* free els, linked via `next_submission` */
+	chron_tw_slot_el_t* free;
+
+	int n_free;
+
+	/* neighbours in the slab's list of caches */
+	struct chron_tw_slab_cache* prev;
+
+	struct chron_tw_slab_cache* next;
+} chron_tw_slab_cache_t;
+
+/**
+ * @brief Per-wheel el allocator. Els are carved out of chunks and never
+ * returned to the system allocator until the wheel is destroyed. Each thread
+ * allocates from and frees to a private cache, only touching the shared,
+ * mutex-protected depot to move a whole batch of els at a time.
+ */
+struct chron_tw_slab {
+	pthread_mutex_t mutex;
+
+	/* key under which each thread's cache is stored */
+	pthread_key_t key;
+
+	/* false if no key could be created; every operation then goes to the depot */
+	bool has_key;
+
+	/* the depot: free els shared by all threads, linked via `next_submission` */
+	chron_tw_slot_el_t* free;
+
+	unsigned long n_free;
+
+	/* every chunk allocated for this slab */
+	chron_tw_slab_chunk_t* chunks;
+
+	/* every thread-local cache, so they can be freed with the slab */
+	chron_tw_slab_cache_t* caches;
+};
+
+/* HELPERS */
+
+/**
+ * @brief Opaque helper. Allocate a new chunk and add its els to the depot.
+ * The caller must hold the slab's mutex.
+ *
+ * @param slab
+ * @return bool
+ */
+bool __slab_grow(chron_tw_slab_t* slab) {
+	chron_tw_slab_chunk_t* chunk = malloc(
+		sizeof(chron_tw_slab_chunk_t) + CHRON_TW_SLAB_CHUNK_SIZE * sizeof(chron_tw_slot_el_t)
+	);
+
+	if (!chunk) return false;
+
+	chunk->next = slab->chunks;
+	slab->chunks = chunk;
+
+	for (int i = 0; i < CHRON_TW_SLAB_CHUNK_SIZE; i++) {
+		chunk->els[i].next_submission = slab->free;
+		slab->free = &chunk->els[i];
+	}
+
+	slab->n_free += CHRON_TW_SLAB_CHUNK_SIZE;
+
+	return true;
+}
+
+/**
+ * @brief Opaque helper. Move up to `n` els from a list into another,
+ * returning the number moved
+ *
+ * @param from
+ * @param to
+ * @param n
+ * @return int
+ */
+int __slab_move(chron_tw_slot_el_t** from, chron_tw_slot_el_t** to, int n) {
+	chron_tw_slot_el_t* el;
+	int moved = 0;
+
+	while (moved < n && *from) {
+		el = *from;
+		*from = el->next_submission;
+
+		el->next_submission = *to;
+		*to = el;
+
+		moved++;
+	}
+
+	return moved;
+}
+
+/**
+ * @brief Opaque helper. Return every el in a thread's cache to the depot when
+ * the thread exits
+ *
+ * @param arg
+ */
+void __slab_cache_destructor(void* arg) {
+	chron_tw_slab_cache_t* cache = (chron_tw_slab_cache_t*)arg;
+	chron_tw_slab_t* slab = cache->slab;
+
+	pthread_mutex_lock(&slab->mutex);
+
+	slab->n_free += __slab_move(&cache->free, &slab->free, cache->n_free);
+
+	if (cache->prev) cache->prev->next = cache->next;
+	else slab->caches = cache->next;
+
+	if (cache->next) cache->next->prev = cache->prev;
+
+	pthread_mutex_unlock(&slab->mutex);
+
+	free(cache);
+}
+
+/**
+ * @brief Opaque helper. Get the calling thread's cache, creating it if necessary
+ *
+ * @param slab
+ * @return chron_tw_slab_cache_t* NULL if the slab has no key or we are out of memory
+ */
+chron_tw_slab_cache_t* __slab_get_cache(chron_tw_slab_t* slab) {
+	chron_tw_slab_cache_t* cache;
+
+	if (!slab->has_key) return NULL;
+
+	cache = pthread_getspecific(slab->key);
+	if (cache) return cache;
+
+	cache = calloc(1, sizeof(chron_tw_slab_cache_t));
+	if (!cache) return NULL;
+
+	cache->slab = slab;
+
+	if (pthread_setspecific(slab->key, cache)) {
+		free(cache);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&slab->mutex);
+
+	cache->next = slab->caches;
+	if (slab->caches) slab->caches->prev = cache;
+	slab->caches = cache;
+
+	pthread_mutex_unlock(&slab->mutex);
+
+	return cache;
+}
+
+/* INTERNAL API */
+
+/**
+ * @brief Create a wheel's slab, preallocating room for at least `prealloc` els
+ *
+ * @param tw
+ * @param prealloc
+ * @return bool
+ */
+bool __slab_init(chron_timer_wheel_t* tw, unsigned long prealloc) {
+	chron_tw_slab_t* slab = calloc(1, sizeof(chron_tw_slab_t));
+
+	if (!slab) return false;
+
+	pthread_mutex_init(&slab->mutex, NULL);
+	slab->has_key = !pthread_key_create(&slab->key, __slab_cache_destructor);
+
+	while (slab->n_free < prealloc) {
+		if (!__slab_grow(slab)) {
+			tw->slab = slab;
+			__slab_destroy(tw);
+
+			return false;
+		}
+	}
+
+	tw->slab = slab;
+
+	return true;
+}
+
+/**
+ * @brief Free a wheel's slab, and with it every el it ever handed out
+ *
+ * @param tw
+ */
+void __slab_destroy(chron_timer_wheel_t* tw) {
+	chron_tw_slab_t* slab = tw->slab;
+	chron_tw_slab_chunk_t* chunk;
+	chron_tw_slab_cache_t* cache;
+
+	if (!slab) return;
+
+	// once the key is gone, exiting threads no longer run the cache destructor
+	if (slab->has_key) {
+		pthread_setspecific(slab->key, NULL);
+		pthread_key_delete(slab->key);
+	}
+
+	while ((cache = slab->caches)) {
+		slab->caches = cache->next;
+		free(cache);
+	}
+
+	while ((chunk = slab->chunks)) {
+		slab->chunks = chunk->next;
+		free(chunk);
+	}
+
+	pthread_mutex_destroy(&slab->mutex);
+	free(slab);
+
+	tw->slab = NULL;
+}
+
+/**
+ * @brief Allocate a zeroed el from the wheel's slab
+ *
+ * @param tw
+ * @return chron_tw_slot_el_t*
+ */
+chron_tw_slot_el_t* __slab_alloc(chron_timer_wheel_t* tw) {
+	chron_tw_slab_t* slab = tw->slab;
+	chron_tw_slab_cache_t* cache = __slab_get_cache(slab);
+	chron_tw_slot_el_t* el = NULL;
+
+	if (cache && cache->free) {
+		el = cache->free;
+		cache->free = el->next_submission;
+		cache->n_free--;
+	} else {
+		pthread_mutex_lock(&slab->mutex);
+
+		if (slab->free || __slab_grow(slab)) {
+			el = slab->free;
+			slab->free = el->next_submission;
+			slab->n_free--;
+
+			// refill the cache so the next allocations stay off the depot
+			if (cache) {
+				int moved = __slab_move(&slab->free, &cache->free, CHRON_TW_SLAB_BATCH);
+
+				cache->n_free += moved;
+				slab->n_free -= moved;
+			}
+		}
+
+		pthread_mutex_unlock(&slab->mutex);
+	}
+
+	if (el) memset(el, 0, sizeof(chron_tw_slot_el_t));
+
+	return el;
+}
+
+/**
+ * @brief Return an el to the wheel's slab
+ *
+ * @param tw
+ * @param el
+ */
+void __slab_free(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el) {
+	chron_tw_slab_t* slab = tw->slab;
+	chron_tw_slab_cache_t* cache = __slab_get_cache(slab);
+
+	if (cache) {
+		el->next_submission = cache->free;
+		cache->free = el;
+
+		if (++cache->n_free <= CHRON_TW_SLAB_CACHE_MAX) return;
+
+		// the cache overflowed; hand a batch back to the depot for other threads
+		pthread_mutex_lock(&slab->mutex);
+
+		int moved = __slab_move(&cache->free, &slab->free, CHRON_TW_SLAB_BATCH);
+		cache->n_free -= moved;
+		slab->n_free += moved;
+
+		pthread_mutex_unlock(&slab->mutex);
+
+		return;
+	}
+
+	pthread_mutex_lock(&slab->mutex);
+
+	el->next_submission = slab->free;
+	slab->free = el;
+	slab->n_free++;
+
+	pthread_mutex_unlock(&slab->mutex);
+}
+
+/**
+ * @brief Allocate `n` zeroed els from the wheel's slab, taking the depot's
+ * mutex at most once
+ *
+ * @param tw
+ * @param els receives the allocated els
+ * @param n
+ * @return bool true only if all `n` els were allocated; if false, none were
+ */
+bool __slab_alloc_batch(chron_timer_wheel_t* tw, chron_tw_slot_el_t** els, int n) {
+	chron_tw_slab_t* slab = tw->slab;
+	chron_tw_slab_cache_t* cache = __slab_get_cache(slab);
+	int i = 0;
+
+	while (cache && cache->free && i < n) {
+		els[i] = cache->free;
+		cache->free = els[i]->next_submission;
+		cache->n_free--;
+		i++;
+	}
+
+	if (i < n) {
+		pthread_mutex_lock(&slab->mutex);
+
+		while (i < n && (slab->free || __slab_grow(slab))) {
+			els[i] = slab->free;
+			slab->free = els[i]->next_submission;
+			slab->n_free--;
+			i++;
+		}
+
+		pthread_mutex_unlock(&slab->mutex);
+	}
+
+	if (i < n) {
+		while (i--) __slab_free(tw, els[i]);
+
+		return false;
+	}
+
+	for (i = 0; i < n; i++) {
+		memset(els[i], 0, sizeof(chron_tw_slot_el_t));
+	}
+
+	return true;
+}
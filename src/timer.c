@@ -1,20 +1,336 @@
-#include "libchron.h"
+#include "internal.h"
 
-#include <stdarg.h>
+#include <sched.h>
 #include <stdio.h>
 
+/* backend used by subsequently initialized timers */
+static chron_timer_backend default_backend = TIMER_BACKEND_POSIX;
+
+/* counters reported by chron_timer_get_stats, shared by every timer */
+static struct {
+	_Atomic uint64_t n_created;
+
+	_Atomic uint64_t n_started;
+
+	_Atomic uint64_t n_rescheduled;
+
+	_Atomic uint64_t n_cancelled;
+
+	_Atomic uint64_t n_deleted;
+
+	_Atomic uint64_t n_fired;
+
+	_Atomic uint64_t n_missed;
+
+	_Atomic uint64_t n_settime;
+} timer_stats;
+
+// bump a shared counter; relaxed, as the counters order nothing
+#define CHRON_TIMER_STAT_ADD(counter, n) \
+	atomic_fetch_add_explicit(&timer_stats.counter, (n), memory_order_relaxed)
+
+/* set in a timer's state while a thread applies a transition to it */
+#define CHRON_TIMER_BUSY 0x100
+
+#define CHRON_TIMER_STATE_BIT(state) (1u << (state))
+
 /**
- * @brief Set the chron_timer state flag
+ * @brief Operations that transition a chron_timer from one state to another
+ */
+typedef enum {
+	TIMER_OP_START,
+	TIMER_OP_PAUSE,
+	TIMER_OP_RESUME,
+	TIMER_OP_CANCEL,
+	/* restart or reschedule */
+	TIMER_OP_REARM,
+	TIMER_OP_DELETE,
+	/* re-arm an exponential timer with its next backoff, after it expires */
+	TIMER_OP_EXPIRE_BACKOFF,
+	/* re-arm a resumed timer with its full expiry, after it expires */
+	TIMER_OP_EXPIRE_RESUMED,
+	/* cancel a timer that has reached its maximum number of expirations */
+	TIMER_OP_EXPIRE_LIMIT,
+	/* program the kernel timer per the timer's itimerspec, leaving its state as it was */
+	TIMER_OP_TOGGLE
+} chron_timer_op;
+
+/* the states from which each operation may be applied, and the state in which it leaves the timer */
+static const struct {
+	unsigned int from;
+
+	chron_timer_state to;
+} timer_transitions[] = {
+	[TIMER_OP_START] = {
+		CHRON_TIMER_STATE_BIT(TIMER_INIT) | CHRON_TIMER_STATE_BIT(TIMER_RUNNING) |
+		CHRON_TIMER_STATE_BIT(TIMER_CANCELLED) | CHRON_TIMER_STATE_BIT(TIMER_PAUSED) |
+		CHRON_TIMER_STATE_BIT(TIMER_RESUMED),
+		TIMER_RUNNING
+	},
+	[TIMER_OP_PAUSE] = {
+		CHRON_TIMER_STATE_BIT(TIMER_INIT) | CHRON_TIMER_STATE_BIT(TIMER_RUNNING) |
+		CHRON_TIMER_STATE_BIT(TIMER_CANCELLED) | CHRON_TIMER_STATE_BIT(TIMER_RESUMED),
+		TIMER_PAUSED
+	},
+	[TIMER_OP_RESUME] = {
+		CHRON_TIMER_STATE_BIT(TIMER_INIT) | CHRON_TIMER_STATE_BIT(TIMER_RUNNING) |
+		CHRON_TIMER_STATE_BIT(TIMER_CANCELLED) | CHRON_TIMER_STATE_BIT(TIMER_PAUSED),
+		TIMER_RESUMED
+	},
+	[TIMER_OP_CANCEL] = {
+		CHRON_TIMER_STATE_BIT(TIMER_RUNNING) | CHRON_TIMER_STATE_BIT(TIMER_CANCELLED) |
+		CHRON_TIMER_STATE_BIT(TIMER_PAUSED) | CHRON_TIMER_STATE_BIT(TIMER_RESUMED),
+		TIMER_CANCELLED
+	},
+	[TIMER_OP_REARM] = {
+		CHRON_TIMER_STATE_BIT(TIMER_RUNNING) | CHRON_TIMER_STATE_BIT(TIMER_CANCELLED) |
+		CHRON_TIMER_STATE_BIT(TIMER_PAUSED) | CHRON_TIMER_STATE_BIT(TIMER_RESUMED),
+		TIMER_RUNNING
+	},
+	[TIMER_OP_DELETE] = {
+		CHRON_TIMER_STATE_BIT(TIMER_INIT) | CHRON_TIMER_STATE_BIT(TIMER_RUNNING) |
+		CHRON_TIMER_STATE_BIT(TIMER_CANCELLED) | CHRON_TIMER_STATE_BIT(TIMER_PAUSED) |
+		CHRON_TIMER_STATE_BIT(TIMER_RESUMED),
+		TIMER_DELETED
+	},
+	[TIMER_OP_EXPIRE_BACKOFF] = {
+		CHRON_TIMER_STATE_BIT(TIMER_RUNNING) | CHRON_TIMER_STATE_BIT(TIMER_RESUMED),
+		TIMER_RUNNING
+	},
+	[TIMER_OP_EXPIRE_RESUMED] = {
+		CHRON_TIMER_STATE_BIT(TIMER_RESUMED),
+		TIMER_RUNNING
+	},
+	[TIMER_OP_EXPIRE_LIMIT] = {
+		CHRON_TIMER_STATE_BIT(TIMER_RUNNING) | CHRON_TIMER_STATE_BIT(TIMER_RESUMED),
+		TIMER_CANCELLED
+	},
+	// `to` is unused; the timer is released in the state it was claimed in
+	[TIMER_OP_TOGGLE] = {
+		CHRON_TIMER_STATE_BIT(TIMER_INIT) | CHRON_TIMER_STATE_BIT(TIMER_RUNNING) |
+		CHRON_TIMER_STATE_BIT(TIMER_CANCELLED) | CHRON_TIMER_STATE_BIT(TIMER_PAUSED) |
+		CHRON_TIMER_STATE_BIT(TIMER_RESUMED),
+		TIMER_INIT
+	}
+};
+
+/**
+ * @brief Get the chron_timer's state, as of its last completed transition
+ *
+ * @param timer
+ * @return chron_timer_state
+ */
+chron_timer_state __timer_getstate(chron_timer_t* timer) {
+	return atomic_load(&timer->timer_state) & ~CHRON_TIMER_BUSY;
+}
+
+/**
+ * @brief Opaque helper. Claim the timer in order to apply an operation to it.
+ * Checking the operation against the transition table and marking the timer
+ * busy take a single compare-and-swap. The timer is held only while the
+ * transition writes its fields and records its deadline, which makes no
+ * syscall; the kernel timer is programmed once the timer is released, by
+ * __timer_sync. While another thread holds the timer, we spin for those few
+ * writes; unless `is_try`, in which case we give up. The expiry path only ever
+ * tries, so a caller never waits on an expiry that has yet to claim the timer.
+ *
+ * @param timer
+ * @param op
+ * @param is_try
+ * @param from set to the state the timer was claimed in
+ * @return bool false if the operation may not be applied in the timer's current state
+ */
+bool __timer_claim(chron_timer_t* timer, chron_timer_op op, bool is_try, chron_timer_state* from) {
+	int state = atomic_load(&timer->timer_state);
+
+	while (true) {
+		if (state & CHRON_TIMER_BUSY) {
+			if (is_try) return false;
+
+			sched_yield();
+			state = atomic_load(&timer->timer_state);
+			continue;
+		}
+
+		if (!(timer_transitions[op].from & CHRON_TIMER_STATE_BIT(state))) return false;
+
+		if (atomic_compare_exchange_weak(&timer->timer_state, &state, state | CHRON_TIMER_BUSY)) break;
+	}
+
+	if (from) *from = state;
+
+	return true;
+}
+
+/**
+ * @brief Opaque helper. Release a claimed timer in the given state
  *
  * @param timer
  * @param state
  */
-void __timer_setstate(chron_timer_t* timer, chron_timer_state state) {
-	timer->timer_state = state;
+void __timer_release(chron_timer_t* timer, chron_timer_state state) {
+	atomic_store(&timer->timer_state, state);
 }
 
-chron_timer_state __timer_getstate(chron_timer_t* timer) {
-	return timer->timer_state;
+/**
+ * @brief Opaque helper. Record periodic expirations the dispatcher skipped
+ *
+ * @param n
+ */
+void __timer_stats_add_missed(uint64_t n) {
+	CHRON_TIMER_STAT_ADD(n_missed, n);
+}
+
+/**
+ * @brief Opaque helper. Record a kernel timer being programmed
+ */
+void __timer_stats_add_settime(void) {
+	CHRON_TIMER_STAT_ADD(n_settime, 1);
+}
+
+/**
+ * @brief Opaque helper. Get the current CLOCK_MONOTONIC time in ns
+ *
+ * @return uint64_t
+ */
+uint64_t __timer_now_ns(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * CHRON_NS_PER_S + now.tv_nsec;
+}
+
+/**
+ * @brief Opaque helper. Record the deadline for which the timer's itimerspec
+ * (`ts`) is to be armed, relative to now; __timer_sync then programs the kernel
+ * timer for it. Writers are serialized by holding the timer, so the seqlock need
+ * only fence out readers.
+ *
+ * @param timer
+ */
+void __timer_set_deadline(chron_timer_t* timer) {
+	uint64_t value_ns = (uint64_t)timer->ts.it_value.tv_sec * CHRON_NS_PER_S + timer->ts.it_value.tv_nsec;
+	uint64_t period_ns = (uint64_t)timer->ts.it_interval.tv_sec * CHRON_NS_PER_S + timer->ts.it_interval.tv_nsec;
+	uint64_t deadline_ns = value_ns ? __timer_now_ns() + value_ns : 0;
+
+	uint32_t seq = atomic_load_explicit(&timer->deadline_seq, memory_order_relaxed);
+
+	atomic_store_explicit(&timer->deadline_seq, seq + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	atomic_store_explicit(&timer->armed_deadline_ns, deadline_ns, memory_order_relaxed);
+	atomic_store_explicit(&timer->armed_period_ns, period_ns, memory_order_relaxed);
+
+	// sequentially consistent, so that a thread giving up __timer_sync sees it
+	atomic_store(&timer->deadline_seq, seq + 2);
+}
+
+/**
+ * @brief Opaque helper. Read the timer's recorded deadline and period
+ *
+ * @param timer
+ * @param deadline_ns 0 if the timer is disarmed
+ * @param period_ns 0 if the timer is one-shot
+ * @return uint32_t the sequence number of the deadline read
+ */
+uint32_t __timer_get_deadline(chron_timer_t* timer, uint64_t* deadline_ns, uint64_t* period_ns) {
+	uint32_t seq;
+
+	do {
+		while ((seq = atomic_load_explicit(&timer->deadline_seq, memory_order_acquire)) & 1) {
+			sched_yield();
+		}
+
+		*deadline_ns = atomic_load_explicit(&timer->armed_deadline_ns, memory_order_relaxed);
+		*period_ns = atomic_load_explicit(&timer->armed_period_ns, memory_order_relaxed);
+
+		atomic_thread_fence(memory_order_acquire);
+	} while (atomic_load_explicit(&timer->deadline_seq, memory_order_relaxed) != seq);
+
+	return seq;
+}
+
+/**
+ * @brief Opaque helper. Get the time until the timer's next expiration in ns,
+ * from its recorded deadline; 0 if it is disarmed or has expired for good.
+ * Periodic expirations fall on a fixed grid from the first deadline, on either
+ * backend, so the next one is derived rather than tracked.
+ *
+ * @param timer
+ * @return uint64_t
+ */
+uint64_t __timer_ns_remaining(chron_timer_t* timer) {
+	uint64_t deadline_ns;
+	uint64_t period_ns;
+
+	__timer_get_deadline(timer, &deadline_ns, &period_ns);
+
+	if (!deadline_ns) return 0;
+
+	uint64_t now = __timer_now_ns();
+
+	if (now < deadline_ns) return deadline_ns - now;
+
+	if (!period_ns) return 0;
+
+	return period_ns - (now - deadline_ns) % period_ns;
+}
+
+/**
+ * @brief Opaque helper. Program the kernel timer to expire at the CLOCK_MONOTONIC
+ * time `deadline_ns`, and every `period_ns` thereafter if nonzero; a zero
+ * `deadline_ns` disarms it. The deadline is absolute, so programming it late
+ * does not postpone it. Cannot fail: the timer's backend resources are all
+ * allocated when the timer is initialized.
+ *
+ * @param timer
+ * @param deadline_ns
+ * @param period_ns
+ */
+void __timer_program(chron_timer_t* timer, uint64_t deadline_ns, uint64_t period_ns) {
+	if (timer->backend == TIMER_BACKEND_TIMERFD) {
+		__dispatcher_arm(timer, deadline_ns, period_ns);
+	} else if (timer->backend == TIMER_BACKEND_WHEEL) {
+		__vtimer_arm(timer, deadline_ns, period_ns);
+	} else {
+		struct itimerspec its = {
+			.it_interval = { .tv_sec = period_ns / CHRON_NS_PER_S, .tv_nsec = period_ns % CHRON_NS_PER_S },
+			.it_value = { .tv_sec = deadline_ns / CHRON_NS_PER_S, .tv_nsec = deadline_ns % CHRON_NS_PER_S }
+		};
+
+		CHRON_TIMER_STAT_ADD(n_settime, 1);
+
+		timer_settime(timer->timer, TIMER_ABSTIME, &its, NULL);
+	}
+}
+
+/**
+ * @brief Opaque helper. Program the kernel timer for the timer's recorded
+ * deadline, once the thread that recorded it has released the timer. One thread
+ * programs a timer at a time; a thread that finds another at it leaves its
+ * deadline to that one rather than wait. The programming thread looks for a
+ * newer deadline each time it is done, and once more after giving way, so the
+ * kernel timer is always left armed for the last deadline recorded.
+ *
+ * @param timer
+ */
+void __timer_sync(chron_timer_t* timer) {
+	while (!atomic_exchange(&timer->is_syncing, true)) {
+		uint64_t deadline_ns;
+		uint64_t period_ns;
+		uint32_t seq;
+
+		while ((seq = __timer_get_deadline(timer, &deadline_ns, &period_ns)) != timer->synced_seq) {
+			__timer_program(timer, deadline_ns, period_ns);
+			timer->synced_seq = seq;
+		}
+
+		atomic_store(&timer->is_syncing, false);
+
+		// a deadline recorded while we were at it by a thread that gave way to us
+		if (atomic_load(&timer->deadline_seq) == seq) return;
+	}
 }
 
 /**
@@ -37,72 +353,139 @@ void __set_itimerspec(struct timespec* ts, unsigned long ms) {
 }
 
 /**
- * @brief Opaque helper. Checks if the timer occupies any
- * of the provided states
+ * @brief Opaque helper. Convert timespec to ms
  *
- * @param nargs
- * @param ...
- * @return bool
+ * @param time
+ * @return unsigned
  */
-bool __timer_has_state(chron_timer_t* timer, int nargs,...) {
-	va_list args;
+unsigned long __timespec_to_ms(struct timespec* time) {
+	unsigned long ms = 0;
+	ms = time->tv_sec * 1000;
+
+  ms += time->tv_nsec / 1000000;
 
-	va_start(args, nargs);
+	return ms;
+}
 
-	for (int i = 0; i < nargs; i++) {
-		chron_timer_state state = va_arg(args, chron_timer_state);
-		if (__timer_getstate(timer) == state) return true;
+/**
+ * @brief Opaque helper. Arm the timer to expire after `exp_time` ms and every
+ * `exp_interval` ms thereafter. The caller must hold the timer, and sync it
+ * once released.
+ *
+ * @param timer
+ * @param exp_time
+ * @param exp_interval ignored if the timer is exponential
+ */
+void __timer_arm(chron_timer_t* timer, unsigned long exp_time, unsigned long exp_interval) {
+	__set_itimerspec(&timer->ts.it_value, exp_time);
+
+	if (!timer->is_exponential) {
+		__set_itimerspec(&timer->ts.it_interval, exp_interval);
+	} else {
+		__set_itimerspec(&timer->ts.it_interval, 0);
+		timer->exponential_backoff_time = exp_time;
 	}
 
-	va_end(args);
+	timer->time_remaining = 0;
 
-	return false;
+	__timer_set_deadline(timer);
 }
 
 /**
- * @brief Opaque helper. Convert timespec to ms
+ * @brief Opaque helper. Disarm the timer; the implementation of
+ * chron_timer_cancel, shared with the expiry path
  *
- * @param time
- * @return unsigned
+ * @param timer
+ * @param op TIMER_OP_CANCEL or TIMER_OP_EXPIRE_LIMIT
+ * @param is_try
+ * @return bool
  */
-unsigned long __timespec_to_ms(struct timespec* time) {
-	unsigned long ms = 0;
-	ms = time->tv_sec * 1000;
+bool __timer_cancel(chron_timer_t* timer, chron_timer_op op, bool is_try) {
+	if (!__timer_claim(timer, op, is_try, NULL)) return false;
 
-  ms += time->tv_nsec / 1000000;
+	__set_itimerspec(&timer->ts.it_value, 0);
+	__set_itimerspec(&timer->ts.it_interval, 0);
 
-	return ms;
+	timer->time_remaining = 0;
+	atomic_store(&timer->invocation_count, 0);
+
+	__timer_set_deadline(timer);
+	__timer_release(timer, timer_transitions[op].to);
+	__timer_sync(timer);
+
+	return true;
 }
 
 /**
  * @brief Opaque helper. Timer callback wrapper
  *
+ * The expiry thread only ever tries to claim the timer: if the caller is
+ * transitioning it at the same time, the caller's operation supersedes
+ * whatever the expiry would have done.
+ *
+ * A transition records the timer's deadline before the kernel timer is
+ * reprogrammed for it, so an expiration may arrive for a deadline the timer no
+ * longer holds; it is dropped.
+ *
  * @param arg
  */
 void __callback_wrapper(union sigval arg) {
 	chron_timer_t* timer = (chron_timer_t*)(arg.sival_ptr);
+	uint64_t deadline_ns;
+	uint64_t period_ns;
 
-	// if the state is TIMER_RESUMED, the timer was *just* resumed, so
-	// we can set the state to TIMER_RUNNING...
-	// provided the timer still has running time (otherwise, we would be stuck in a loop)
-	// if (__timer_getstate(timer) == TIMER_RESUMED && timer->exp_time != 0) {
-	// 	__timer_setstate(timer, TIMER_RUNNING);
-	// }
+	__timer_get_deadline(timer, &deadline_ns, &period_ns);
 
-	timer->invocation_count++;
+	// the timer was disarmed, or re-armed for later, since the kernel timer fired
+	if (!deadline_ns || __timer_now_ns() < deadline_ns) return;
 
-	if (timer->threshold && timer->invocation_count > timer->threshold) {
-		chron_timer_cancel(timer);
+	uint32_t n_invocations = atomic_fetch_add(&timer->invocation_count, 1) + 1;
+
+	if (timer->threshold && n_invocations > timer->threshold) {
+		__timer_cancel(timer, TIMER_OP_EXPIRE_LIMIT, true);
 		return;
 	}
 
+	// POSIX timers count the expirations they could not deliver in the meantime
+	if (timer->backend == TIMER_BACKEND_POSIX) {
+		int n_overrun = timer_getoverrun(timer->timer);
+
+		if (n_overrun > 0) CHRON_TIMER_STAT_ADD(n_missed, n_overrun);
+	}
+
+	CHRON_TIMER_STAT_ADD(n_fired, 1);
+
 	(timer->callback)(timer, timer->callback_arg);
 
-	if (timer->is_exponential && timer->exponential_backoff_time) {
-		chron_timer_reschedule(timer, timer->exponential_backoff_time *= 2, 0);
-	} else if (timer->timer_state == TIMER_RESUMED) {
-		chron_timer_reschedule(timer, timer->exp_time, timer->exp_interval);
+	chron_timer_op op;
+	chron_timer_state from;
+
+	if (timer->is_exponential) {
+		op = TIMER_OP_EXPIRE_BACKOFF;
+	} else if (__timer_getstate(timer) == TIMER_RESUMED) {
+		op = TIMER_OP_EXPIRE_RESUMED;
+	} else {
+		return;
+	}
+
+	if (!__timer_claim(timer, op, true, &from)) return;
+
+	if (op == TIMER_OP_EXPIRE_BACKOFF) {
+		// a backoff of 0 never grows; the timer stays as it is
+		if (!timer->exponential_backoff_time) {
+			__timer_release(timer, from);
+			return;
+		}
+
+		__timer_arm(timer, timer->exponential_backoff_time * 2, 0);
+	} else {
+		__timer_arm(timer, timer->exp_time, timer->exp_interval);
 	}
+
+	__timer_release(timer, timer_transitions[op].to);
+	__timer_sync(timer);
+
+	CHRON_TIMER_STAT_ADD(n_rescheduled, 1);
 }
 
 
@@ -113,6 +496,16 @@ void __callback_wrapper(union sigval arg) {
  ****************************/
 
 
+/**
+ * @brief Set the backend used by every subsequently initialized chron_timer.
+ * Timers that already exist keep the backend with which they were initialized.
+ *
+ * @param backend
+ */
+void chron_timer_set_backend(chron_timer_backend backend) {
+	default_backend = backend;
+}
+
 /**
  * @brief Initialize a new chron_timer
  *
@@ -132,7 +525,7 @@ chron_timer_t* chron_timer_init(
 	uint32_t max_expirations, // 0 for infinite
 	bool is_exponential
 ) {
-	chron_timer_t* timer = malloc(sizeof(chron_timer_t));
+	chron_timer_t* timer = calloc(1, sizeof(chron_timer_t));
 
 	if (!timer) return NULL;
 
@@ -143,17 +536,32 @@ chron_timer_t* chron_timer_init(
 	timer->is_exponential = is_exponential;
 	timer->threshold = max_expirations;
 
-	__timer_setstate(timer, TIMER_INIT);
+	timer->backend = default_backend;
 
-	struct sigevent evp;
-	memset(&evp, 0, sizeof(struct sigevent));
+	atomic_init(&timer->timer_state, TIMER_INIT);
 
-	evp.sigev_value.sival_ptr = (void*)(timer);
-	evp.sigev_notify = SIGEV_THREAD;
-	evp.sigev_notify_function = __callback_wrapper;
+	if (timer->backend == TIMER_BACKEND_TIMERFD) {
+		if (!__dispatcher_register(timer)) {
+			free(timer);
+			return NULL;
+		}
+	} else if (timer->backend == TIMER_BACKEND_WHEEL) {
+		if (!__vtimer_register(timer)) {
+			free(timer);
+			return NULL;
+		}
+	} else {
+		struct sigevent evp;
+		memset(&evp, 0, sizeof(struct sigevent));
 
-	if (timer_create(CLOCK_REALTIME, &evp, &timer->timer) < 0) {
-		return NULL;
+		evp.sigev_value.sival_ptr = (void*)(timer);
+		evp.sigev_notify = SIGEV_THREAD;
+		evp.sigev_notify_function = __callback_wrapper;
+
+		if (timer_create(CLOCK_MONOTONIC, &evp, &timer->timer) < 0) {
+			free(timer);
+			return NULL;
+		}
 	}
 
 	__set_itimerspec(&timer->ts.it_value, timer->exp_time);
@@ -166,45 +574,58 @@ chron_timer_t* chron_timer_init(
 		__set_itimerspec(&timer->ts.it_interval, 0);
 	}
 
+	CHRON_TIMER_STAT_ADD(n_created, 1);
+
 	return timer;
 }
 
 /**
  * @brief Resurrect a timer that is not running; stop a running timer.
  * To stop the timer, the itimerspec members (ts)
- * must be set to zero.
+ * must be set to zero. Blocks while another thread is applying a
+ * transition to the timer.
  *
  * @param timer
  * @return bool true only if toggle succeeded
  */
 bool chron_timer_toggle(chron_timer_t* timer) {
-	if (timer_settime(timer->timer, 0, &timer->ts, NULL) < 0) {
-		return false;
-	}
+	chron_timer_state from;
+
+	if (!__timer_claim(timer, TIMER_OP_TOGGLE, false, &from)) return false;
+
+	__timer_set_deadline(timer);
+	__timer_release(timer, from);
+	__timer_sync(timer);
 
 	return true;
 }
 
 /**
- * @brief Start a stopped timer
+ * @brief Start a stopped timer. Blocks while another thread is applying a
+ * transition to the timer.
  *
  * @param timer
  */
 void chron_timer_start(chron_timer_t* timer) {
-	chron_timer_toggle(timer);
-	__timer_setstate(timer, TIMER_RUNNING);
+	if (!__timer_claim(timer, TIMER_OP_START, false, NULL)) return;
+
+	__timer_set_deadline(timer);
+	__timer_release(timer, TIMER_RUNNING);
+	__timer_sync(timer);
+
+	CHRON_TIMER_STAT_ADD(n_started, 1);
 }
 
 /**
- * @brief Get the remaining time of the given chron_timer in ms
+ * @brief Get the remaining time of the given chron_timer in ms. Computed from
+ * the deadline recorded when the timer was armed, without a syscall; safe to
+ * call from any thread.
  *
  * @param timer
  * @return unsigned long
  */
 unsigned long chron_timer_get_ms_remaining(chron_timer_t* timer) {
-	struct itimerspec time_remaining;
-
-	switch (timer->timer_state){
+	switch (__timer_getstate(timer)){
 		case TIMER_INIT:
 		case TIMER_PAUSED:
 		case TIMER_RUNNING:
@@ -216,122 +637,95 @@ unsigned long chron_timer_get_ms_remaining(chron_timer_t* timer) {
 			break;
 	}
 
-	memset(&time_remaining, 0, sizeof(struct itimerspec));
-
-	timer_gettime(timer->timer, &time_remaining);
-
-	return __timespec_to_ms(&time_remaining.it_value);
+	return __timer_ns_remaining(timer) / CHRON_NS_PER_MS;
 }
 
 /**
- * @brief Pause a running timer
+ * @brief Pause a running timer. Blocks while another thread is applying a
+ * transition to the timer.
  *
  * @param timer
  * @return bool true only if pause succeeded
  */
 bool chron_timer_pause(chron_timer_t* timer) {
-	if (__timer_has_state(
-		timer,
-		2,
-		TIMER_PAUSED,
-		TIMER_DELETED
-	)) return false;
+	if (!__timer_claim(timer, TIMER_OP_PAUSE, false, NULL)) return false;
 
-	timer->time_remaining = chron_timer_get_ms_remaining(timer);
+	// round up, lest a timer paused within its last ms resume disarmed
+	timer->time_remaining = (__timer_ns_remaining(timer) + CHRON_NS_PER_MS - 1) / CHRON_NS_PER_MS;
 
 	__set_itimerspec(&timer->ts.it_value, 0);
 	__set_itimerspec(&timer->ts.it_interval, 0);
 
-	if (!chron_timer_toggle(timer)) return false;
-
-	__timer_setstate(timer, TIMER_PAUSED);
+	__timer_set_deadline(timer);
+	__timer_release(timer, TIMER_PAUSED);
+	__timer_sync(timer);
 
 	return true;
 }
 
 /**
- * @brief Resume a paused timer
+ * @brief Resume a paused timer. Blocks while another thread is applying a
+ * transition to the timer.
  *
  * @param timer
  * @return bool true only if resume succeeded
  */
 bool chron_timer_resume(chron_timer_t* timer) {
-	if (__timer_has_state(
-		timer,
-		2,
-		TIMER_RESUMED,
-		TIMER_DELETED
-	)) return false;
+	if (!__timer_claim(timer, TIMER_OP_RESUME, false, NULL)) return false;
 
 	__set_itimerspec(&timer->ts.it_value, timer->time_remaining);
 	__set_itimerspec(&timer->ts.it_interval, timer->exp_interval);
 	timer->time_remaining = 0;
 
-	if (!chron_timer_toggle(timer)) return false;
-
-	__timer_setstate(timer, TIMER_RESUMED);
+	__timer_set_deadline(timer);
+	__timer_release(timer, TIMER_RESUMED);
+	__timer_sync(timer);
 
 	return true;
 }
 
 /**
- * @brief Restart the given chron_timer
+ * @brief Restart the given chron_timer. The timer is re-armed in place, with a
+ * single timer_settime. Blocks while another thread is applying a
+ * transition to the timer.
  *
  * @param timer
  * @return bool
  */
 bool chron_timer_restart(chron_timer_t* timer) {
-	if (__timer_has_state(
-		timer,
-		1,
-		TIMER_DELETED
-	)) return false;
+	if (!__timer_claim(timer, TIMER_OP_REARM, false, NULL)) return false;
 
-	if (!chron_timer_cancel(timer)) return false;
+	atomic_store(&timer->invocation_count, 0);
 
-	__set_itimerspec(&timer->ts.it_value, timer->exp_time);
+	__timer_arm(timer, timer->exp_time, timer->exp_interval);
+	__timer_release(timer, TIMER_RUNNING);
+	__timer_sync(timer);
 
-	if (!timer->is_exponential) {
-		__set_itimerspec(&timer->ts.it_interval, timer->exp_interval);
-	} else {
-		__set_itimerspec(&timer->ts.it_interval, 0);
-	}
-
-	timer->invocation_count = 0;
-	timer->time_remaining = 0;
-	timer->exponential_backoff_time = timer->exp_time;
-	if (!chron_timer_toggle(timer)) return false;
-	__timer_setstate(timer, TIMER_RUNNING);
+	CHRON_TIMER_STAT_ADD(n_rescheduled, 1);
 
 	return true;
 }
 
 /**
- * @brief Cancel the timer
+ * @brief Cancel the timer. Blocks while another thread is applying a
+ * transition to the timer.
  *
  * @param timer
  * @return bool
  */
 bool chron_timer_cancel(chron_timer_t* timer) {
-	if (__timer_has_state(timer, 2, TIMER_INIT, TIMER_DELETED)) {
-		return false;
-	}
-
-	__set_itimerspec(&timer->ts.it_value, 0);
-	__set_itimerspec(&timer->ts.it_interval, 0);
-
-	timer->time_remaining = 0;
-	timer->invocation_count = 0;
+	if (!__timer_cancel(timer, TIMER_OP_CANCEL, false)) return false;
 
-	if (!chron_timer_toggle(timer)) return false;
-
-	__timer_setstate(timer, TIMER_CANCELLED);
+	CHRON_TIMER_STAT_ADD(n_cancelled, 1);
 
 	return true;
 }
 
 /**
- * @brief Reschedule the chron_timer
+ * @brief Reschedule the chron_timer. The timer is re-armed in place, with a
+ * single timer_settime, which replaces the previous expiry outright; it need
+ * not be disarmed first. Blocks while another thread is applying a
+ * transition to the timer.
  *
  * @param timer
  * @param exp_time
@@ -343,54 +737,97 @@ bool chron_timer_reschedule(
 	unsigned long exp_time,
 	unsigned long exp_interval
 ) {
-	uint32_t invocation_counter;
-	chron_timer_state state = __timer_getstate(timer);
+	if (!__timer_claim(timer, TIMER_OP_REARM, false, NULL)) return false;
 
-	if (state == TIMER_DELETED) return false;
+	__timer_arm(timer, exp_time, exp_interval);
+	__timer_release(timer, TIMER_RUNNING);
+	__timer_sync(timer);
 
-	invocation_counter = timer->invocation_count;
+	CHRON_TIMER_STAT_ADD(n_rescheduled, 1);
 
-	if (state != TIMER_CANCELLED) {
-		if (!chron_timer_cancel(timer)) return false;
-	}
+	return true;
+}
+
+/**
+ * @brief Delete the timer. Blocks while another thread is applying a
+ * transition to the timer, or programming its kernel timer.
+ * The caller must free `callback_arg`. On TIMER_BACKEND_TIMERFD and
+ * TIMER_BACKEND_WHEEL, once this returns the timer's callback is neither
+ * running nor ever invoked again, unless this is called from that callback
+ *
+ * @param timer
+ * @return bool
+ */
+bool chron_timer_delete(chron_timer_t* timer) {
+	if (!__timer_claim(timer, TIMER_OP_DELETE, false, NULL)) return false;
 
-	timer->invocation_count = invocation_counter;
+	__set_itimerspec(&timer->ts.it_value, 0);
+	__set_itimerspec(&timer->ts.it_interval, 0);
 
-	__set_itimerspec(&timer->ts.it_value, exp_time);
+	__timer_set_deadline(timer);
 
-	if (!timer->is_exponential) {
-		__set_itimerspec(&timer->ts.it_interval, exp_interval);
+	// detaching waits for a running callback, which may itself be waiting to
+	// claim the timer; it must find the timer deleted instead
+	__timer_release(timer, TIMER_DELETED);
+
+	// wait out a thread programming the kernel timer, and keep any other from
+	// doing so again; no deadline can be recorded once the timer is deleted, so
+	// the wait is short
+	while (atomic_exchange(&timer->is_syncing, true)) sched_yield();
+
+	if (timer->backend == TIMER_BACKEND_WHEEL) {
+		__vtimer_unregister(timer);
+	} else if (timer->backend == TIMER_BACKEND_TIMERFD) {
+		__dispatcher_unregister(timer);
 	} else {
-		__set_itimerspec(&timer->ts.it_interval, 0);
-		timer->exponential_backoff_time = exp_time;
+		timer_delete(timer->timer);
 	}
 
-	timer->time_remaining = 0;
-	if (!chron_timer_toggle(timer)) return false;
+	timer->callback_arg = NULL;
 
-	__timer_setstate(timer, TIMER_RUNNING);
+	CHRON_TIMER_STAT_ADD(n_deleted, 1);
 
 	return true;
 }
 
 /**
- * @brief Delete the timer
- * The caller must free `callback_arg`
+ * @brief Allow the timer's expirations to be delivered up to `slack_ms` late,
+ * so that timers whose windows overlap share a single wakeup of the kernel
+ * timer. Takes effect immediately, including for an armed timer.
  *
  * @param timer
- * @return bool
+ * @param slack_ms
+ * @return bool false if the timer's backend does not coalesce expirations
+ * (TIMER_BACKEND_POSIX, whose timers each fire on their exact deadline, and
+ * TIMER_BACKEND_WHEEL, whose timers already share the wheel's 1ms ticks)
  */
-bool chron_timer_delete(chron_timer_t* timer) {
-	if (timer_delete(timer->timer) < 0) {
-		return false;
-	}
+bool chron_timer_set_slack(chron_timer_t* timer, unsigned long slack_ms) {
+	if (timer->backend != TIMER_BACKEND_TIMERFD) return false;
 
-	timer->callback_arg = NULL;
-	__timer_setstate(timer, TIMER_DELETED);
+	__dispatcher_set_slack(timer, (uint64_t)slack_ms * CHRON_NS_PER_MS);
 
 	return true;
 }
 
+/**
+ * @brief Read the counters shared by every chron_timer. Safe to call from any thread.
+ *
+ * @param stats
+ */
+void chron_timer_get_stats(chron_timer_stats_t* stats) {
+	if (!stats) return;
+
+	stats->n_created = atomic_load_explicit(&timer_stats.n_created, memory_order_relaxed);
+	stats->n_started = atomic_load_explicit(&timer_stats.n_started, memory_order_relaxed);
+	stats->n_rescheduled = atomic_load_explicit(&timer_stats.n_rescheduled, memory_order_relaxed);
+	stats->n_cancelled = atomic_load_explicit(&timer_stats.n_cancelled, memory_order_relaxed);
+	stats->n_deleted = atomic_load_explicit(&timer_stats.n_deleted, memory_order_relaxed);
+	stats->n_fired = atomic_load_explicit(&timer_stats.n_fired, memory_order_relaxed);
+	stats->n_missed = atomic_load_explicit(&timer_stats.n_missed, memory_order_relaxed);
+	stats->n_armed = __dispatcher_get_n_armed();
+	stats->n_settime = atomic_load_explicit(&timer_stats.n_settime, memory_order_relaxed);
+}
+
 const char* getEnumStr(chron_timer_state state) {
 
 }
@@ -430,7 +867,7 @@ void chron_timer_print(chron_timer_t* timer) {
 
 	printf(
 		"counter = %u | time remaining = %lu | state = %s\n",
-		timer->invocation_count,
+		atomic_load(&timer->invocation_count),
 		chron_timer_get_ms_remaining(timer),
 		readable_state
 	);
@@ -0,0 +1,232 @@
+#include "internal.h"
+
+#include <limits.h>
+
+/**
+ * @brief Backs every TIMER_BACKEND_WHEEL chron_timer with a single event on a
+ * shared timer wheel of 1ms ticks, so that such timers cost no kernel timer and
+ * their expirations are delivered on the wheel thread, with no thread created
+ * per expiration.
+ *
+ * A timer's event is registered with the timer, so that it is published before
+ * the wheel thread can ever run it, and rescheduled whenever the timer is armed.
+ * The timer records the CLOCK_MONOTONIC deadline at
+ * which the event must next fire; disarming clears it, and an event that fires
+ * for a deadline the timer no longer holds is ignored. Periodic timers are
+ * re-armed on the wheel thread for the next deadline on their grid, so their
+ * expirations do not drift.
+ */
+typedef struct chron_vtimer_wheel {
+	chron_timer_wheel_t* tw;
+
+	/* whether initialization succeeded */
+	bool is_ready;
+} chron_vtimer_wheel_t;
+
+static chron_vtimer_wheel_t vtimer_wheel;
+
+static pthread_once_t vtimer_once = PTHREAD_ONCE_INIT;
+
+/* number of level 0 slots of the shared wheel; about a second of 1ms ticks */
+#define CHRON_VTIMER_WHEEL_SIZE 1024
+
+/* interval at which a timer's event is registered, before the timer is armed */
+#define CHRON_VTIMER_IDLE_INTERVAL INT_MAX
+
+/* HELPERS */
+
+/**
+ * @brief Opaque helper. Get the current CLOCK_MONOTONIC time in ns
+ *
+ * @return uint64_t
+ */
+uint64_t __vtimer_now_ns(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * CHRON_NS_PER_S + now.tv_nsec;
+}
+
+/**
+ * @brief Opaque helper. Convert a duration in ns to a wheel interval in ms,
+ * rounding up so the event never fires early. Durations beyond the range of an
+ * interval are clamped; the event then re-arms itself for the rest when it fires.
+ *
+ * @param ns
+ * @return int
+ */
+int __vtimer_interval(uint64_t ns) {
+	uint64_t ms = (ns + CHRON_NS_PER_MS - 1) / CHRON_NS_PER_MS;
+
+	return ms > INT_MAX ? INT_MAX : (int)ms;
+}
+
+/**
+ * @brief Opaque helper. Reschedule a timer's event for the deadline we read,
+ * from its own callback. A __vtimer_arm may store a new deadline after we read
+ * ours and submit it before we submit ours, in which case ours, being latest,
+ * would win; so once ours is submitted, we read the deadline again and submit
+ * that until it stands. A __vtimer_arm landing after that read submits after
+ * us, and so wins.
+ *
+ * @param timer
+ * @param deadline_ns
+ */
+void __vtimer_resubmit(chron_timer_t* timer, uint64_t deadline_ns) {
+	uint64_t seen_ns;
+
+	do {
+		uint64_t now = __vtimer_now_ns();
+
+		chron_timer_wheel_reschedule_ev(
+			vtimer_wheel.tw,
+			timer->vtimer_el,
+			__vtimer_interval(deadline_ns > now ? deadline_ns - now : 0)
+		);
+
+		seen_ns = deadline_ns;
+		deadline_ns = atomic_load(&timer->vtimer_deadline_ns);
+
+		// once disarmed, a stale fire finds no deadline and is ignored
+	} while (deadline_ns && deadline_ns != seen_ns);
+}
+
+/**
+ * @brief Opaque helper. The wheel callback of every timer's event
+ *
+ * @param arg the chron_timer
+ * @param arg_size
+ */
+void __vtimer_expire(void* arg, int arg_size) {
+	chron_timer_t* timer = (chron_timer_t*)arg;
+	uint64_t deadline_ns = atomic_load(&timer->vtimer_deadline_ns);
+	uint64_t next_ns = 0;
+
+	(void)arg_size;
+
+	// the timer was disarmed since the event was scheduled
+	if (!deadline_ns) return;
+
+	uint64_t now = __vtimer_now_ns();
+
+	// the timer was re-armed for later, or its deadline was out of range of one interval
+	if (deadline_ns > now) {
+		__vtimer_resubmit(timer, deadline_ns);
+		return;
+	}
+
+	uint64_t period_ns = atomic_load(&timer->vtimer_period_ns);
+
+	if (period_ns) {
+		// expirations missed while we were behind are skipped, as with a POSIX timer's overrun
+		next_ns = deadline_ns + period_ns;
+
+		if (next_ns <= now) {
+			uint64_t n_missed = (now - next_ns) / period_ns + 1;
+
+			next_ns += n_missed * period_ns;
+			__timer_stats_add_missed(n_missed);
+		}
+	}
+
+	// unless the timer was re-armed in the meantime, in which case that deadline stands
+	if (!atomic_compare_exchange_strong(&timer->vtimer_deadline_ns, &deadline_ns, next_ns)) return;
+
+	if (next_ns) __vtimer_resubmit(timer, next_ns);
+
+	__callback_wrapper((union sigval){ .sival_ptr = timer });
+}
+
+/**
+ * @brief Opaque helper. Create and start the shared wheel
+ */
+void __vtimer_init(void) {
+	chron_tw_opts_t opts = {
+		.size = CHRON_VTIMER_WHEEL_SIZE,
+		.tick_interval = 1,
+		.resolution_ns = CHRON_NS_PER_MS,
+		.backend = TW_BACKEND_WHEEL
+	};
+
+	if (!(vtimer_wheel.tw = chron_timer_wheel_init_opts(&opts))) return;
+
+	if (!chron_timer_wheel_start(vtimer_wheel.tw)) {
+		chron_timer_wheel_destroy(vtimer_wheel.tw);
+		vtimer_wheel.tw = NULL;
+		return;
+	}
+
+	vtimer_wheel.is_ready = true;
+}
+
+/* INTERNAL API */
+
+/**
+ * @brief Attach a timer to the shared wheel, starting the wheel if necessary
+ *
+ * @param timer
+ * @return bool
+ */
+bool __vtimer_register(chron_timer_t* timer) {
+	pthread_once(&vtimer_once, __vtimer_init);
+
+	atomic_init(&timer->vtimer_deadline_ns, 0);
+	atomic_init(&timer->vtimer_period_ns, 0);
+
+	if (!vtimer_wheel.is_ready) return false;
+
+	// with no deadline set, the event is ignored should it fire before being armed
+	timer->vtimer_el = chron_timer_wheel_register_ev(
+		vtimer_wheel.tw,
+		__vtimer_expire,
+		timer,
+		sizeof(chron_timer_t),
+		CHRON_VTIMER_IDLE_INTERVAL,
+		0
+	);
+
+	return timer->vtimer_el != NULL;
+}
+
+/**
+ * @brief Arm the timer to expire at the CLOCK_MONOTONIC time `deadline_ns`, and
+ * every `period_ns` thereafter if nonzero. A zero `deadline_ns` disarms the timer.
+ *
+ * @param timer
+ * @param deadline_ns
+ * @param period_ns
+ */
+void __vtimer_arm(chron_timer_t* timer, uint64_t deadline_ns, uint64_t period_ns) {
+	// the event is left to fire, and ignored when it does
+	if (!deadline_ns) {
+		atomic_store(&timer->vtimer_deadline_ns, 0);
+		return;
+	}
+
+	uint64_t now = __vtimer_now_ns();
+
+	atomic_store(&timer->vtimer_period_ns, period_ns);
+	atomic_store(&timer->vtimer_deadline_ns, deadline_ns);
+
+	chron_timer_wheel_reschedule_ev(
+		vtimer_wheel.tw,
+		timer->vtimer_el,
+		__vtimer_interval(deadline_ns > now ? deadline_ns - now : 0)
+	);
+}
+
+/**
+ * @brief Detach a timer from the shared wheel. Once this returns, the timer's
+ * callback is neither running nor ever invoked again, unless this is called
+ * from that callback. The caller must not hold the timer, as the callback may
+ * be waiting on it.
+ *
+ * @param timer
+ */
+void __vtimer_unregister(chron_timer_t* timer) {
+	atomic_store(&timer->vtimer_deadline_ns, 0);
+
+	chron_timer_wheel_unregister_ev(vtimer_wheel.tw, timer->vtimer_el);
+	timer->vtimer_el = NULL;
+}
@@ -1,308 +1,1845 @@
-#include "libchron.h"
+#define _GNU_SOURCE
 
+#include "internal.h"
+
+#include <errno.h>
+#include <sched.h>
 #include <unistd.h>
+#include <sys/timerfd.h>
+
+/* MACROS (opaque) */
+
+/* Getters */
+#define CHRON_TW_GET_SLOT(tw, idx) (&(tw->slots[idx]))
+
+#define CHRON_TW_GET_SLOT_HEAD(tw, idx) (&(tw->slots[idx].linked_list))
+
+#define CHRON_TW_GET_SLOT_MUTEX(tw, idx) (&(tw->slots[idx].mutex))
+
+#define CHRON_TW_GET_UPTIME(tw) (CHRON_TW_GET_ABS_SLOT_N(tw) * tw->tick_interval)
+
+#define CHRON_TW_GET_SLOTS_AT_IDX(tw, idx) (&(tw->slots[idx]))
+
+// the *absolute* slot number since the wheel routine began
+#define CHRON_TW_GET_ABS_SLOT_N(tw)	atomic_load_explicit(&(tw)->abs_tick, memory_order_relaxed)
+
+#define CHRON_TW_GET_SLOT_EMPTY(slot) (!atomic_load_explicit(&(slot)->n_els, memory_order_relaxed))
+
+// number of slots in the given level
+#define CHRON_TW_GET_LEVEL_SIZE(tw, level) ((level) ? CHRON_TW_LEVEL_SIZE : tw->ring_size)
+
+// index of the given level's first slot in the flattened slots array
+#define CHRON_TW_GET_LEVEL_OFFSET(tw, level) \
+	((level) ? tw->ring_size + ((level) - 1) * CHRON_TW_LEVEL_SIZE : 0)
+
+// number of ticks spanned by a single slot in the given level
+#define CHRON_TW_GET_LEVEL_SPAN(tw, level) \
+	((level) ? (uint64_t)tw->ring_size << (CHRON_TW_LEVEL_BITS * ((level) - 1)) : 1)
+
+// number of ticks spanned by a full revolution of the given level
+#define CHRON_TW_GET_LEVEL_RANGE(tw, level) \
+	((uint64_t)tw->ring_size << (CHRON_TW_LEVEL_BITS * (level)))
+
+#define CHRON_TW_GET_N_SLOTS(tw) \
+	(tw->ring_size + (CHRON_TW_N_LEVELS - 1) * CHRON_TW_LEVEL_SIZE)
+
+// number of words in the occupancy bitmap
+#define CHRON_TW_GET_N_OCCUPANCY_WORDS(tw) ((CHRON_TW_GET_N_SLOTS(tw) + 63) / 64)
+
+// sentinel for a wheel with no scheduled events
+#define CHRON_TW_NEVER UINT64_MAX
+
+// pack an opcode and interval into an el's pending operation word
+#define CHRON_TW_OP_PACK(opcode, interval) (((uint64_t)(opcode) << 32) | (uint32_t)(interval))
+
+#define CHRON_TW_OP_GET_OPCODE(op) ((chron_tw_opcode)((op) >> 32))
+
+#define CHRON_TW_OP_GET_INTERVAL(op) ((int)(uint32_t)(op))
+
+/* Setters */
+#define CHRON_TW_SET_LOCK_SLOT(slot) pthread_mutex_lock(&(slot->mutex))
+
+#define CHRON_TW_SET_UNLOCK_SLOT(slot) pthread_mutex_unlock(&(slot->mutex))
+
+// the bitmap is shared by every slot's lock, so its words are updated atomically
+#define CHRON_TW_SET_OCCUPIED(tw, idx) \
+	atomic_fetch_or_explicit(&tw->occupancy[(idx) / 64], 1ULL << ((idx) % 64), memory_order_relaxed)
+
+#define CHRON_TW_SET_VACANT(tw, idx) \
+	atomic_fetch_and_explicit(&tw->occupancy[(idx) / 64], ~(1ULL << ((idx) % 64)), memory_order_relaxed)
+
+// add to a counter only the wheel thread writes; a plain load and store suffice
+#define CHRON_TW_SET_COUNTER_ADD(counter, n) \
+	atomic_store_explicit(&(counter), atomic_load_explicit(&(counter), memory_order_relaxed) + (n), memory_order_relaxed)
+
+/* initial room in a wheel's batch of deferred els */
+#define CHRON_TW_BATCH_PREALLOC 64
+
+/* el whose callback the calling thread is invoking, if any */
+static __thread chron_tw_slot_el_t* current_el = NULL;
+
+/* its address identifies the calling thread as the `batch_owner` of els */
+static __thread char batch_token;
+
+/* HELPERS */
+
+/**
+ * @brief Convert an interval to a number of ticks. Events never fire early,
+ * so partial ticks are rounded up; every event is at least one tick out.
+ *
+ * @param tw
+ * @param interval
+ * @return uint64_t
+ */
+uint64_t __interval_to_ticks(chron_timer_wheel_t* tw, int interval) {
+	if (interval <= tw->tick_interval) return 1;
+
+	return ((uint64_t)interval + tw->tick_interval - 1) / tw->tick_interval;
+}
+
+/**
+ * @brief Determine the tick at which an event is next due. An event with
+ * slack may fire anywhere from `interval` to `interval + slack` out; of the
+ * ticks in that window, we pick the one that is a multiple of the greatest
+ * power of two, so that events whose windows overlap converge on the same
+ * tick and share a slot and a wakeup.
+ *
+ * @param tw
+ * @param now tick relative to which `interval` is measured
+ * @param interval
+ * @param slack
+ * @return uint64_t
+ */
+uint64_t __deadline_tick(chron_timer_wheel_t* tw, uint64_t now, int interval, int slack) {
+	uint64_t earliest = now + __interval_to_ticks(tw, interval);
+	uint64_t latest;
+	uint64_t mask;
+
+	if (slack <= 0) return earliest;
+
+	// the latest tick is rounded down; the event must not fire after its window
+	latest = now + ((uint64_t)interval + slack) / tw->tick_interval;
+	if (latest <= earliest) return earliest;
+
+	// clear every bit below the highest one in which the window's bounds differ
+	mask = (1ULL << (63 - __builtin_clzll(earliest ^ latest))) - 1;
+
+	return latest & ~mask;
+}
+
+/**
+ * @brief Opaque helper. Convert a timespec to ns
+ *
+ * @param ts
+ * @return uint64_t
+ */
+uint64_t __tw_timespec_to_ns(struct timespec* ts) {
+	return (uint64_t)ts->tv_sec * CHRON_NS_PER_S + ts->tv_nsec;
+}
+
+/**
+ * @brief Opaque helper. Convert ns to a timespec
+ *
+ * @param ns
+ * @param ts
+ */
+void __tw_ns_to_timespec(uint64_t ns, struct timespec* ts) {
+	ts->tv_sec = ns / CHRON_NS_PER_S;
+	ts->tv_nsec = ns % CHRON_NS_PER_S;
+}
+
+/**
+ * @brief Opaque helper. Get the current CLOCK_MONOTONIC time in ns
+ *
+ * @return uint64_t
+ */
+uint64_t __tw_now_ns(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return __tw_timespec_to_ns(&now);
+}
+
+/**
+ * @brief Opaque helper. Get the number of ns elapsed since the wheel was started
+ *
+ * @param tw
+ * @return uint64_t
+ */
+uint64_t __tw_elapsed_ns(chron_timer_wheel_t* tw) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return __tw_timespec_to_ns(&now) - __tw_timespec_to_ns(&tw->epoch);
+}
+
+/**
+ * @brief Opaque helper. Get the tick relative to which a producer's interval
+ * is measured. If the wheel is running, this is read from the clock, as the
+ * wheel thread may be idle or behind; partial ticks are rounded up so that
+ * events never fire early.
+ *
+ * @param tw
+ * @return uint64_t
+ */
+uint64_t __tw_now_tick(chron_timer_wheel_t* tw) {
+	uint64_t processed = CHRON_TW_GET_ABS_SLOT_N(tw);
+	uint64_t due;
+
+	if (!atomic_load(&tw->is_running)) return processed;
+
+	due = (__tw_elapsed_ns(tw) + tw->tick_ns - 1) / tw->tick_ns;
+
+	return due > processed ? due : processed;
+}
+
+/**
+ * @brief Push a chain of els, linked via `next_submission`, onto the wheel's
+ * submission queue with a single atomic operation. Lock-free; producers never
+ * block on the wheel thread.
+ *
+ * @param tw
+ * @param first
+ * @param last
+ * @param n number of els in the chain
+ */
+void __submissions_push(
+	chron_timer_wheel_t* tw,
+	chron_tw_slot_el_t* first,
+	chron_tw_slot_el_t* last,
+	int n
+) {
+	chron_tw_slot_el_t* head = atomic_load_explicit(&tw->submissions, memory_order_relaxed);
+
+	// counted before the push so the wheel never drains more than was counted
+	atomic_fetch_add_explicit(&tw->n_waiting, n, memory_order_relaxed);
+
+	do {
+		last->next_submission = head;
+	} while (!atomic_compare_exchange_weak_explicit(
+		&tw->submissions,
+		&head,
+		first,
+		memory_order_seq_cst,
+		memory_order_relaxed
+	));
+}
+
+/**
+ * @brief Opaque helper. Arm a pollable wheel's timerfd for the given tick, or
+ * disarm it if CHRON_TW_NEVER
+ *
+ * @param tw
+ * @param tick
+ */
+void __poll_settime(chron_timer_wheel_t* tw, uint64_t tick) {
+	struct itimerspec its;
+	uint64_t ns;
+
+	memset(&its, 0, sizeof(struct itimerspec));
+
+	if (tick != CHRON_TW_NEVER) {
+		ns = __tw_timespec_to_ns(&tw->epoch) + tick * tw->tick_ns;
+
+		// an absolute deadline of zero would disarm the timerfd
+		__tw_ns_to_timespec(ns ? ns : 1, &its.it_value);
+	}
+
+	timerfd_settime(tw->fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+/**
+ * @brief Arm a pollable wheel's timerfd for the given tick. Producers lowering
+ * `next_wake_tick` and the thread processing the wheel may race to arm it, so
+ * whoever arms it last re-arms it for any sooner tick published meanwhile.
+ *
+ * @param tw
+ * @param tick
+ */
+void __poll_arm(chron_timer_wheel_t* tw, uint64_t tick) {
+	uint64_t wake;
+
+	__poll_settime(tw, tick);
+
+	while ((wake = atomic_load(&tw->next_wake_tick)) && wake < tick) {
+		tick = wake;
+		__poll_settime(tw, tick);
+	}
+}
+
+/**
+ * @brief Wake the idle wheel thread if an event due at the given tick would be
+ * due before the thread intends to wake; for a pollable wheel, re-arm its
+ * timerfd instead
+ *
+ * @param tw
+ * @param tick
+ */
+void __wake_if_sooner(chron_timer_wheel_t* tw, uint64_t tick) {
+	uint64_t wake = atomic_load(&tw->next_wake_tick);
+
+	if (!wake || tick >= wake) return;
+
+	if (tw->is_pollable) {
+		while (tick < wake) {
+			if (atomic_compare_exchange_weak(&tw->next_wake_tick, &wake, tick)) {
+				__poll_arm(tw, tick);
+				return;
+			}
+
+			// the wheel is being processed, and will see our submission
+			if (!wake) return;
+		}
+
+		return;
+	}
+
+	pthread_mutex_lock(&tw->idle_mutex);
+	tw->is_woken = true;
+	pthread_cond_signal(&tw->idle_cond);
+	pthread_mutex_unlock(&tw->idle_mutex);
+}
+
+/**
+ * @brief Record an operation requested on an el. Only the most recent
+ * operation requested before the wheel next drains its submissions is applied.
+ *
+ * @param el
+ * @param due tick at which the el is next due
+ * @param next_interval
+ * @param opcode
+ * @return bool true if the el must be pushed onto the submission queue; false
+ * if it is already queued, in which case the wheel will observe the new operation
+ */
+bool __submission_prepare(
+	chron_tw_slot_el_t* el,
+	uint64_t due,
+	int next_interval,
+	chron_tw_opcode opcode
+) {
+	// the submission holds a reference so the wheel cannot free the el under us
+	atomic_fetch_add(&el->refs, 1);
+
+	// publish the new deadline right away, so readers need not wait on the wheel
+	atomic_store(&el->due_tick, due);
+
+	if (el->tw->latency) {
+		atomic_store_explicit(&el->pending_ns, __tw_now_ns(), memory_order_relaxed);
+	}
+	atomic_store(&el->pending, CHRON_TW_OP_PACK(opcode, next_interval));
+
+	if (atomic_exchange(&el->is_queued, true)) {
+		__el_release(el);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Request an operation on an el
+ *
+ * @param tw
+ * @param el
+ * @param next_interval
+ * @param opcode
+ */
+void __reschedule_ev(
+	chron_timer_wheel_t* tw,
+	chron_tw_slot_el_t* el,
+	int next_interval,
+	chron_tw_opcode opcode
+) {
+	uint64_t due;
+
+switch(opcode){
+	case TW_CREATE:
+	case TW_RESCHEDULED:
+		due = __deadline_tick(tw, __tw_now_tick(tw), next_interval, el->slack);
+
+		if (__submission_prepare(el, due, next_interval, opcode)) {
+			__submissions_push(tw, el, el, 1);
+		}
+
+		__wake_if_sooner(tw, due);
+		break;
+
+	case TW_DELETE:
+		__el_cancel(tw, el);
+		break;
+
+	default:
+		break;
+	}
+
+}
+
+/**
+ * @brief Check that an event descriptor can be registered
+ *
+ * @param desc
+ * @return bool
+ */
+bool __desc_is_valid(const chron_tw_ev_desc_t* desc) {
+	if ((!desc->callback && !desc->batch_callback) || desc->slack < 0) return false;
+
+	return !desc->is_arg_inline || (
+		desc->arg_size >= 0 &&
+		desc->arg_size <= CHRON_TW_INLINE_ARG_MAX &&
+		(desc->arg || !desc->arg_size)
+	);
+}
+
+/**
+ * @brief Initialize a freshly allocated el per its descriptor
+ *
+ * @param tw
+ * @param el
+ * @param desc
+ */
+void __el_init(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el, const chron_tw_ev_desc_t* desc) {
+	el->tw = tw;
+
+	el->callback = desc->callback;
+	el->batch_callback = desc->batch_callback;
+	if (desc->arg && desc->arg_size){
+		el->callback_arg = desc->arg;
+		el->arg_size = desc->arg_size;
+  }
+
+	// the callback receives a pointer to the copy, which lives as long as the el
+	if (desc->is_arg_inline && desc->arg_size) {
+		memcpy(el->inline_arg, desc->arg, desc->arg_size);
+		el->callback_arg = el->inline_arg;
+	}
+
+	el->is_recurring = desc->recurring;
+	el->slack = desc->slack;
+	el->worker = atomic_fetch_add(&tw->next_worker, 1);
+	atomic_init(&el->refs, 1);
+	atomic_init(&el->is_deleted, false);
+	atomic_init(&el->n_busy, 0);
+	atomic_init(&el->batch_owner, NULL);
+	atomic_init(&el->waiting_on, NULL);
+	atomic_init(&el->slot_head, NULL);
+
+	el->opcode = TW_CREATE;
+	atomic_init(&el->pending, 0);
+	atomic_init(&el->is_queued, false);
+
+	glthread_init(&el->linked_list_node);
+
+	el->n_scheduled = 0;
+}
+
+/**
+ * @brief Apply the offset of a slot's linked list node in the glthread
+ *
+ * @param glthread
+ * @return chron_tw_slot_el_t*
+ */
+chron_tw_slot_el_t* __slot_glthread_to_el(glthread_t* glthread) {
+	return (chron_tw_slot_el_t*)((char*)(glthread) - (char*)&(((chron_tw_slot_el_t*)0)->linked_list_node));
+}
+
+/**
+ * @brief Drop a reference to an el, freeing it once the last one is gone.
+ * References are held by the wheel until the el is unregistered, by each
+ * pending submission and by each callback queued on a worker.
+ *
+ * @param el
+ */
+void __el_release(chron_tw_slot_el_t* el) {
+	if (atomic_fetch_sub(&el->refs, 1) == 1) {
+		__slab_free(el->tw, el);
+	}
+}
+
+/**
+ * @brief Invoke an el's callback unless the el has been unregistered. The
+ * caller must hold the el (see `__el_hold`), so that unregistering it waits
+ * for the callback to return.
+ *
+ * @param el
+ * @return bool whether the callback was invoked
+ */
+bool __el_invoke(chron_tw_slot_el_t* el) {
+	chron_tw_slot_el_t* outer = current_el;
+
+	if (atomic_load(&el->is_deleted)) return false;
+
+	current_el = el;
+	el->callback(el->callback_arg, el->arg_size);
+	current_el = outer;
+
+	return true;
+}
+
+/**
+ * @brief Invoke an expired el's callback, or hand it to the el's worker in
+ * pool dispatch mode
+ *
+ * @param tw
+ * @param el
+ */
+void __dispatch_el(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el) {
+	uint64_t deadline_ns = 0;
+	uint64_t start_ns;
+
+	if (tw->latency) {
+		deadline_ns = __tw_timespec_to_ns(&tw->epoch) + el->expires * tw->tick_ns;
+	}
+
+	if (tw->n_workers) {
+		__pool_submit(tw, el, deadline_ns);
+		return;
+	}
+
+	if (!tw->latency) {
+		__el_invoke(el);
+		return;
+	}
+
+	start_ns = __tw_now_ns();
+
+	if (!__el_invoke(el)) return;
+
+	__latency_record(tw, CHRON_TW_LATENCY_LATENESS, start_ns > deadline_ns ? start_ns - deadline_ns : 0);
+	__latency_record(tw, CHRON_TW_LATENCY_EXEC, __tw_now_ns() - start_ns);
+}
+
+/**
+ * @brief Opaque helper. Order batch entries by batch callback, then by the
+ * order in which they came due
+ *
+ * @param a
+ * @param b
+ * @return int
+ */
+int __batch_entry_cmp(const void* a, const void* b) {
+	const chron_tw_batch_entry_t* x = a;
+	const chron_tw_batch_entry_t* y = b;
+	uintptr_t fx = (uintptr_t)x->el->batch_callback;
+	uintptr_t fy = (uintptr_t)y->el->batch_callback;
+
+	if (fx != fy) return fx < fy ? -1 : 1;
+
+	return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+/**
+ * @brief Invoke the batch callback of every el deferred during the current
+ * tick, once per distinct callback, then let go of the els
+ *
+ * @param tw
+ */
+void __batch_flush(chron_timer_wheel_t* tw) {
+	unsigned long n = tw->batch_len;
+	unsigned long i;
+	unsigned long end;
+
+	if (!n) return;
+
+	qsort(tw->batch, n, sizeof(chron_tw_batch_entry_t), __batch_entry_cmp);
+
+	for (i = 0; i < n; i = end) {
+		chron_tw_batch_callback batch_callback = tw->batch[i].el->batch_callback;
+		int n_args = 0;
+
+		for (end = i; end < n && tw->batch[end].el->batch_callback == batch_callback; end++) {
+			chron_tw_slot_el_t* el = tw->batch[end].el;
+
+			// unregistered since it came due, e.g. by an earlier callback
+			if (!atomic_load(&el->is_deleted)) tw->batch_args[n_args++] = el->callback_arg;
+		}
+
+		if (n_args) batch_callback(tw->batch_args, n_args);
+	}
+
+	for (i = 0; i < n; i++) {
+		atomic_store(&tw->batch[i].el->batch_owner, NULL);
+		__el_unhold(tw->batch[i].el);
+	}
+
+	tw->batch_len = 0;
+}
+
+/**
+ * @brief Defer an expired el's batch callback to the end of the tick. The el
+ * must be held; it stays held until the batch is flushed.
+ *
+ * @param tw
+ * @param el
+ */
+void __batch_defer(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el) {
+	if (tw->batch_len == tw->batch_capacity) {
+		unsigned long capacity = tw->batch_capacity ? tw->batch_capacity * 2 : CHRON_TW_BATCH_PREALLOC;
+		chron_tw_batch_entry_t* batch = realloc(tw->batch, capacity * sizeof(chron_tw_batch_entry_t));
+		void** args = NULL;
+
+		if (batch) {
+			tw->batch = batch;
+			args = realloc(tw->batch_args, capacity * sizeof(void*));
+		}
+
+		if (args) {
+			tw->batch_args = args;
+			tw->batch_capacity = capacity;
+		}
+	}
+
+	// out of memory; the el gets a batch of its own
+	if (tw->batch_len == tw->batch_capacity) {
+		chron_tw_slot_el_t* outer = current_el;
+		void* arg = el->callback_arg;
+
+		current_el = el;
+		el->batch_callback(&arg, 1);
+		current_el = outer;
+
+		__el_unhold(el);
+		return;
+	}
+
+	// lets a callback run by this thread unregister the el without waiting on the batch
+	atomic_store(&el->batch_owner, &batch_token);
+
+	tw->batch[tw->batch_len].el = el;
+	tw->batch[tw->batch_len].seq = tw->batch_len;
+	tw->batch_len++;
+}
+
+/**
+ * @brief Append an element to the tail of a slot's array or linked list. The
+ * caller must hold the slot's lock.
+ *
+ * @param slot
+ * @param el
+ */
+void __slot_append(chron_tw_slot* slot, chron_tw_slot_el_t* el) {
+	if (el->tw->heap) {
+		__tw_heap_push(el->tw, el);
+	} else if (el->tw->is_array && __tw_array_append(slot, el)) {
+		CHRON_TW_SET_OCCUPIED(el->tw, slot - el->tw->slots);
+	} else {
+		// an array slot's list takes only the els for which its array could not grow
+		glthread_init(&el->linked_list_node);
+		glthread_insert_after(
+			slot->tail ? slot->tail : &slot->linked_list,
+			&el->linked_list_node
+		);
+
+		slot->tail = &el->linked_list_node;
+		CHRON_TW_SET_OCCUPIED(el->tw, slot - el->tw->slots);
+	}
+
+	atomic_store(&el->slot_head, slot);
+
+	CHRON_TW_SET_COUNTER_ADD(slot->n_els, 1);
+}
+
+/**
+ * @brief Unlink an element from the slot to which it belongs, if any. The
+ * caller must hold that slot's lock.
+ *
+ * @param el
+ */
+void __slot_unlink(chron_tw_slot_el_t* el) {
+	chron_tw_slot* slot = atomic_load_explicit(&el->slot_head, memory_order_relaxed);
+
+	if (!slot) return;
+
+	atomic_store(&el->slot_head, NULL);
+
+	CHRON_TW_SET_COUNTER_ADD(slot->n_els, -1);
+
+	if (el->tw->heap) {
+		__tw_heap_remove(el->tw, el);
+		return;
+	}
+
+	if (el->tw->is_array && __tw_array_remove(slot, el)) {
+		if (CHRON_TW_GET_SLOT_EMPTY(slot)) CHRON_TW_SET_VACANT(el->tw, slot - el->tw->slots);
+		return;
+	}
+
+	if (slot->tail == &el->linked_list_node) {
+		slot->tail = el->linked_list_node.prev == &slot->linked_list
+			? NULL
+			: el->linked_list_node.prev;
+	}
+
+	glthread_remove(&el->linked_list_node);
+
+	if (CHRON_TW_GET_SLOT_EMPTY(slot)) {
+		CHRON_TW_SET_VACANT(el->tw, slot - el->tw->slots);
+	}
+}
+
+/**
+ * @brief Unlink an element from whichever slot it is in, taking that slot's
+ * lock. The wheel thread may move the el to another slot in the meantime, so
+ * the slot is checked again once it is locked.
+ *
+ * @param el
+ */
+void __el_detach(chron_tw_slot_el_t* el) {
+	chron_tw_slot* slot;
+
+	while ((slot = atomic_load(&el->slot_head))) {
+		CHRON_TW_SET_LOCK_SLOT(slot);
+
+		if (atomic_load_explicit(&el->slot_head, memory_order_relaxed) == slot) {
+			__slot_unlink(el);
+			CHRON_TW_SET_UNLOCK_SLOT(slot);
+			return;
+		}
+
+		CHRON_TW_SET_UNLOCK_SLOT(slot);
+	}
+}
+
+/**
+ * @brief Hold an el outside of any slot. Unregistering the el waits until
+ * every holder has let go of it.
+ *
+ * @param el
+ */
+void __el_hold(chron_tw_slot_el_t* el) {
+	atomic_fetch_add(&el->refs, 1);
+	atomic_fetch_add(&el->n_busy, 1);
+}
+
+/**
+ * @brief Let go of an el held via `__el_hold`
+ *
+ * @param el
+ */
+void __el_unhold(chron_tw_slot_el_t* el) {
+	atomic_fetch_sub(&el->n_busy, 1);
+
+	// an unregister of the el may be waiting for us to let go
+	if (atomic_load(&el->is_deleted)) {
+		pthread_mutex_lock(&el->tw->unheld_mutex);
+		pthread_cond_broadcast(&el->tw->unheld_cond);
+		pthread_mutex_unlock(&el->tw->unheld_mutex);
+	}
+
+	__el_release(el);
+}
+
+/**
+ * @brief Take the first element out of a slot, holding it on the caller's behalf
+ *
+ * @param slot
+ * @return chron_tw_slot_el_t* NULL if the slot is empty
+ */
+chron_tw_slot_el_t* __slot_pop(chron_tw_slot* slot) {
+	chron_tw_slot_el_t* el = NULL;
+
+	CHRON_TW_SET_LOCK_SLOT(slot);
+
+	// an array slot's list holds only the els that found no room in its array
+	if (slot->array_len) {
+		el = __tw_array_first(slot);
+	} else if (!IS_GLTHREAD_EMPTY(&slot->linked_list)) {
+		el = __slot_glthread_to_el(slot->linked_list.next);
+	}
+
+	if (el) {
+		// held before it leaves the slot, so an unregister cannot miss it in transit
+		__el_hold(el);
+		__slot_unlink(el);
+	}
+
+	CHRON_TW_SET_UNLOCK_SLOT(slot);
+
+	return el;
+}
+
+/**
+ * @brief Take the earliest element out of a heap wheel's heap if it is due by
+ * the given tick, holding it on the caller's behalf
+ *
+ * @param tw
+ * @param now
+ * @return chron_tw_slot_el_t* NULL if nothing is due
+ */
+chron_tw_slot_el_t* __tw_heap_pop_due(chron_timer_wheel_t* tw, uint64_t now) {
+	chron_tw_slot* slot = __tw_heap_slot(tw);
+	chron_tw_slot_el_t* el;
+
+	CHRON_TW_SET_LOCK_SLOT(slot);
+
+	el = __tw_heap_peek(tw);
+
+	if (el && el->expires <= now) {
+		__el_hold(el);
+		__slot_unlink(el);
+	} else {
+		el = NULL;
+	}
+
+	CHRON_TW_SET_UNLOCK_SLOT(slot);
+
+	return el;
+}
+
+/**
+ * @brief Wait until no thread holds an unregistered el, e.g. to invoke its
+ * callback; one that picks it up from then on observes `is_deleted` and lets
+ * go. The caller's own hold, if it is the el's callback, is left to it, and so
+ * is the el's, if its callback is itself waiting on the caller's.
+ *
+ * @param tw
+ * @param el
+ */
+void __el_await_unheld(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el) {
+	chron_tw_slot_el_t* self = current_el;
+	int n_own = self == el || atomic_load(&el->batch_owner) == &batch_token ? 1 : 0;
+
+	if (atomic_load(&el->n_busy) <= n_own) return;
+
+	if (self) atomic_store(&self->waiting_on, el);
+
+	pthread_mutex_lock(&tw->unheld_mutex);
+
+	while (atomic_load(&el->n_busy) > n_own && !(self && atomic_load(&el->waiting_on) == self)) {
+		pthread_cond_wait(&tw->unheld_cond, &tw->unheld_mutex);
+	}
+
+	pthread_mutex_unlock(&tw->unheld_mutex);
+
+	if (self) atomic_store(&self->waiting_on, NULL);
+}
+
+/**
+ * @brief Unregister an el. The el is unlinked from its slot right away, and
+ * once this returns its callback is neither running nor ever invoked again;
+ * unless this is called from the el's own callback, which is left to finish,
+ * or from the callback of an el whose own unregistering that callback is
+ * waiting on, which would otherwise never finish.
+ *
+ * @param tw
+ * @param el
+ */
+void __el_cancel(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el) {
+	// only the first unregister counts
+	if (atomic_exchange(&el->is_deleted, true)) return;
+
+	atomic_store(&el->due_tick, 0);
+
+	__el_detach(el);
+
+	__el_await_unheld(tw, el);
+
+	if (tw->heap) __tw_heap_unreserve(tw);
+
+	atomic_fetch_sub_explicit(&tw->n_slots, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&tw->n_cancelled, 1, memory_order_relaxed);
+
+	// drop the reference held by the wheel; pending submissions and queued
+	// callbacks keep the el alive until they are done with it
+	__el_release(el);
+}
+
+/**
+ * @brief Find the first occupied slot in the range [start, end) of the
+ * flattened slots array
+ *
+ * @param tw
+ * @param start
+ * @param end
+ * @return int the slot's index, or -1 if every slot in the range is empty
+ */
+int __occupancy_find(chron_timer_wheel_t* tw, int start, int end) {
+	int i = start;
+
+	while (i < end) {
+		uint64_t word = atomic_load_explicit(&tw->occupancy[i / 64], memory_order_relaxed) >> (i % 64);
+
+		if (word) {
+			i += __builtin_ctzll(word);
+			return i < end ? i : -1;
+		}
+
+		i = (i / 64 + 1) * 64;
+	}
+
+	return -1;
+}
+
+/**
+ * @brief Find the first occupied slot of a level, searching circularly from `from`
+ *
+ * @param tw
+ * @param level
+ * @param from slot number within the level
+ * @return int the slot number within the level, or -1 if the level is empty
+ */
+int __occupancy_find_in_level(chron_timer_wheel_t* tw, int level, int from) {
+	int offset = CHRON_TW_GET_LEVEL_OFFSET(tw, level);
+	int size = CHRON_TW_GET_LEVEL_SIZE(tw, level);
+	int idx = __occupancy_find(tw, offset + from, offset + size);
+
+	if (idx < 0) idx = __occupancy_find(tw, offset, offset + from);
+
+	return idx < 0 ? -1 : idx - offset;
+}
+
+/**
+ * @brief Determine the next tick at which anything happens on the wheel; that
+ * is, the next tick at which an occupied slot expires or is cascaded. Every
+ * tick before it can be skipped outright.
+ *
+ * @param tw
+ * @return uint64_t the tick, or CHRON_TW_NEVER if the wheel is empty
+ */
+uint64_t __next_due_tick(chron_timer_wheel_t* tw) {
+	uint64_t now = CHRON_TW_GET_ABS_SLOT_N(tw);
+	uint64_t next = CHRON_TW_NEVER;
+	int current = now % tw->ring_size;
+	int idx;
+
+	if (tw->heap) {
+		chron_tw_slot* slot = __tw_heap_slot(tw);
+		chron_tw_slot_el_t* el;
+
+		CHRON_TW_SET_LOCK_SLOT(slot);
+
+		if ((el = __tw_heap_peek(tw))) next = el->expires > now ? el->expires : now + 1;
+
+		CHRON_TW_SET_UNLOCK_SLOT(slot);
+
+		return next;
+	}
+
+	// level 0: the slots after the current one, wrapping around to it
+	idx = __occupancy_find_in_level(tw, 0, (current + 1) % tw->ring_size);
+	if (idx >= 0) {
+		next = now + (idx > current ? idx - current : idx + tw->ring_size - current);
+	}
+
+	// outer levels: the boundary at which the first occupied slot is cascaded
+	for (int level = 1; level < CHRON_TW_N_LEVELS; level++) {
+		uint64_t span = CHRON_TW_GET_LEVEL_SPAN(tw, level);
+		uint64_t boundary = now / span + 1;
+		int from = boundary % CHRON_TW_LEVEL_SIZE;
+
+		idx = __occupancy_find_in_level(tw, level, from);
+		if (idx < 0) continue;
+
+		boundary += (idx - from + CHRON_TW_LEVEL_SIZE) % CHRON_TW_LEVEL_SIZE;
+
+		if (boundary * span < next) next = boundary * span;
+	}
+
+	return next;
+}
+
+/**
+ * @brief Move the wheel's clock to the given tick without processing the ticks
+ * in between. No slot may be due in the skipped range.
+ *
+ * @param tw
+ * @param tick
+ */
+void __skip_to_tick(chron_timer_wheel_t* tw, uint64_t tick) {
+	atomic_store_explicit(&tw->abs_tick, tick, memory_order_relaxed);
+
+	tw->current_tick = tick % tw->ring_size;
+	tw->n_revolutions = tick / tw->ring_size;
+}
+
+/**
+ * @brief Find the slot in the finest wheel level able to hold an element's
+ * deadline. This is O(1) regardless of how far out the deadline is.
+ *
+ * @param tw
+ * @param el
+ * @return chron_tw_slot*
+ */
+chron_tw_slot* __slot_for_el(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el) {
+	uint64_t now = CHRON_TW_GET_ABS_SLOT_N(tw);
+	uint64_t delta = el->expires - now;
+	int level = 0;
+
+	while (level < CHRON_TW_N_LEVELS - 1 && delta >= CHRON_TW_GET_LEVEL_RANGE(tw, level)) {
+		level++;
+	}
+
+	// deadlines beyond the outermost level are parked in its farthest slot;
+	// the event is cascaded back out when that slot comes due
+	if (delta >= CHRON_TW_GET_LEVEL_RANGE(tw, level)) {
+		delta = CHRON_TW_GET_LEVEL_RANGE(tw, level) - 1;
+	}
+
+	el->level = level;
+	el->slot_n = ((now + delta) / CHRON_TW_GET_LEVEL_SPAN(tw, level)) % CHRON_TW_GET_LEVEL_SIZE(tw, level);
+
+	return CHRON_TW_GET_SLOT(tw, CHRON_TW_GET_LEVEL_OFFSET(tw, level) + el->slot_n);
+}
+
+/**
+ * @brief Place an element in the slot that holds its deadline, or in the heap
+ * of a heap wheel
+ *
+ * @param tw
+ * @param el
+ */
+void __place_el(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el) {
+	chron_tw_slot* slot;
+	uint64_t now = CHRON_TW_GET_ABS_SLOT_N(tw);
+
+	// an event can at best land in the slot of the tick currently being processed
+	if (el->expires < now) el->expires = now;
+
+	slot = tw->heap ? __tw_heap_slot(tw) : __slot_for_el(tw, el);
+
+	CHRON_TW_SET_LOCK_SLOT(slot);
+	__slot_append(slot, el);
+	CHRON_TW_SET_UNLOCK_SLOT(slot);
+
+	// an unregister that found the el in no slot relies on us to take it back out
+	if (atomic_load(&el->is_deleted)) __el_detach(el);
+}
+
+/**
+ * @brief Move every element of an outer level slot into the inner levels
+ *
+ * @param tw
+ * @param level
+ * @param idx slot number within the level
+ * @return int the slot number that was cascaded
+ */
+int __cascade(chron_timer_wheel_t* tw, int level, int idx) {
+	chron_tw_slot* slot = CHRON_TW_GET_SLOT(tw, CHRON_TW_GET_LEVEL_OFFSET(tw, level) + idx);
+	chron_tw_slot_el_t* el;
+
+	// an array slot is drained under a single hold of its lock; each el is held
+	// while in transit, and the finer slot into which it moves is never this one
+	if (tw->is_array) {
+		CHRON_TW_SET_LOCK_SLOT(slot);
+
+		while ((el = __tw_array_first(slot))) {
+			__el_hold(el);
+			__slot_unlink(el);
+			__place_el(tw, el);
+			__el_unhold(el);
+		}
+
+		CHRON_TW_SET_UNLOCK_SLOT(slot);
+	}
+
+	// els always cascade into a finer level, so the slot drains
+	while ((el = __slot_pop(slot))) {
+		__place_el(tw, el);
+		__el_unhold(el);
+	}
+
+	return idx;
+}
+
+/**
+ * @brief Advance the wheel by a single tick, cascading any outer slots that
+ * come due and invoking the events of the current level 0 slot
+ *
+ * @param tw
+ */
+void __process_tick(chron_timer_wheel_t* tw) {
+	chron_tw_slot* slot = NULL;
+	chron_tw_slot_el_t* el = NULL;
+	uint64_t now;
+
+	now = CHRON_TW_GET_ABS_SLOT_N(tw) + 1;
+
+	__skip_to_tick(tw, now);
+
+	CHRON_TW_SET_COUNTER_ADD(tw->n_ticks, 1);
+
+	// start a new revolution, if necessary; every completed revolution of a level
+	// brings the next slot of the level above it due
+	if (tw->current_tick == 0 && !tw->heap) {
+
+		for (int level = 1; level < CHRON_TW_N_LEVELS; level++) {
+			int idx = (now / CHRON_TW_GET_LEVEL_SPAN(tw, level)) % CHRON_TW_LEVEL_SIZE;
+
+			if (__cascade(tw, level, idx)) break;
+		}
+	}
+
+	// retrieve the current slot (linked list of event els); every el therein is due
+	slot = CHRON_TW_GET_SLOT(tw, tw->current_tick);
+
+	// els are taken out one at a time, so no lock is held while a callback runs
+	while ((el = tw->heap ? __tw_heap_pop_due(tw, now) : __slot_pop(slot))) {
+		if (atomic_load(&el->is_deleted)) {
+			__el_unhold(el);
+			continue;
+		}
+
+		// a reschedule to a later tick is still queued; the el fires then instead
+		if (atomic_load(&el->due_tick) > now) {
+			__el_unhold(el);
+			continue;
+		}
+
+		if (el->batch_callback) {
+			__el_hold(el);
+			__batch_defer(tw, el);
+		} else {
+			__dispatch_el(tw, el);
+		}
+
+		CHRON_TW_SET_COUNTER_ADD(tw->n_fired, 1);
+
+		// reschedule periodic events relative to this tick, unless the callback unregistered it
+		if (el->is_recurring && !atomic_load(&el->is_deleted)) {
+			uint64_t fired = el->expires;
+
+			el->expires = __deadline_tick(tw, now, el->interval, el->slack);
+			__place_el(tw, el);
+
+			// unless a producer has requested a new deadline in the meantime
+			atomic_compare_exchange_strong(&el->due_tick, &fired, el->expires);
+
+			el->n_scheduled++;
+		} else if (!el->is_recurring) {
+			uint64_t fired = el->expires;
+
+			// a one-shot is no longer scheduled, unless it was rescheduled in the meantime
+			atomic_compare_exchange_strong(&el->due_tick, &fired, 0);
+		}
+
+		__el_unhold(el);
+	}
+
+	__batch_flush(tw);
+}
+
+/**
+ * @brief Apply any pending create, reschedule and batch unregister operations.
+ * The whole submission queue is taken with a single atomic exchange. A single
+ * unregister bypasses the queue; a submission for an el unregistered since is
+ * dropped.
+ *
+ * @param tw
+ */
+void __reschedule_slot(chron_timer_wheel_t* tw) {
+	chron_tw_slot_el_t* batch;
+	chron_tw_slot_el_t* el;
+	chron_tw_slot_el_t* next;
+	chron_tw_slot_el_t* ordered = NULL;
+	uint64_t op;
+	uint64_t due;
+	uint64_t drained_ns = 0;
+	uint64_t n_drained = 0;
+
+	batch = atomic_exchange_explicit(&tw->submissions, NULL, memory_order_acquire);
+
+	if (batch && tw->latency) drained_ns = __tw_now_ns();
+
+	// the stack yields the most recent submission first; restore submission order
+	while (batch) {
+		next = batch->next_submission;
+		batch->next_submission = ordered;
+		ordered = batch;
+		batch = next;
+	}
+
+	for (el = ordered; el; el = next) {
+		// the link must be read before the el is released back to producers
+		next = el->next_submission;
+		n_drained++;
+
+		atomic_store(&el->is_queued, false);
+		op = atomic_load(&el->pending);
+		due = atomic_load(&el->due_tick);
+
+		if (tw->latency) {
+			uint64_t pending_ns = atomic_load_explicit(&el->pending_ns, memory_order_relaxed);
+
+			__latency_record(tw, CHRON_TW_LATENCY_SUBMIT, drained_ns > pending_ns ? drained_ns - pending_ns : 0);
+		}
+
+		switch (CHRON_TW_OP_GET_OPCODE(op)) {
+			case TW_CREATE:
+			case TW_RESCHEDULED:
+				__el_hold(el);
+				__el_detach(el);
+
+				// the el was unregistered after it was submitted
+				if (atomic_load(&el->is_deleted)) {
+					__el_unhold(el);
+					break;
+				}
+
+				el->interval = CHRON_TW_OP_GET_INTERVAL(op);
+				el->expires = due;
+
+				// the deadline passed while the submission was queued; fire as soon as possible
+				if (el->expires <= CHRON_TW_GET_ABS_SLOT_N(tw)) {
+					el->expires = CHRON_TW_GET_ABS_SLOT_N(tw) + 1;
+					atomic_compare_exchange_strong(&el->due_tick, &due, el->expires);
+				}
+
+				__place_el(tw, el);
+				__el_unhold(el);
+
+				el->n_scheduled++;
+
+				// a create may have been superseded by a reschedule before we got to it
+				if (el->opcode != TW_CREATE) CHRON_TW_SET_COUNTER_ADD(tw->n_rescheduled, 1);
+
+				el->opcode = TW_SCHEDULED;
+				break;
+
+			case TW_DELETE:
+				// unregistered in a batch, which left taking it out of the wheel to us
+				__el_detach(el);
+
+				if (tw->heap) __tw_heap_unreserve(tw);
+
+				// drop the reference held by the wheel
+				__el_release(el);
+				break;
+
+			default:
+				break;
+		}
+
+		// drop the reference held by the submission
+		__el_release(el);
+	}
+
+	if (n_drained) atomic_fetch_sub_explicit(&tw->n_waiting, n_drained, memory_order_relaxed);
+}
+
+/**
+ * @brief Process every tick up to and including `target`, skipping straight
+ * over runs of ticks at which nothing is due
+ *
+ * @param tw
+ * @param target
+ */
+void __advance_to_tick(chron_timer_wheel_t* tw, uint64_t target) {
+	uint64_t next;
+
+	while (CHRON_TW_GET_ABS_SLOT_N(tw) < target) {
+		next = __next_due_tick(tw);
+
+		if (next > target) {
+			__skip_to_tick(tw, target);
+			break;
+		}
+
+		// the clock has moved past the tick's successor; we are behind by that many ticks
+		if (next < target) CHRON_TW_SET_COUNTER_ADD(tw->n_ticks_missed, target - next);
+
+		__skip_to_tick(tw, next - 1);
+		__process_tick(tw);
+	}
+}
+
+/**
+ * @brief Opaque helper. Wait until the given tick is due or the wheel thread is
+ * woken early
+ *
+ * @param tw
+ * @param tick
+ */
+void __idle_until(chron_timer_wheel_t* tw, uint64_t tick) {
+	struct timespec deadline;
+
+	if (tick != CHRON_TW_NEVER) {
+		__tw_ns_to_timespec(__tw_timespec_to_ns(&tw->epoch) + tick * tw->tick_ns, &deadline);
+	}
+
+	pthread_mutex_lock(&tw->idle_mutex);
+
+	while (!tw->is_woken) {
+		if (tick == CHRON_TW_NEVER) {
+			pthread_cond_wait(&tw->idle_cond, &tw->idle_mutex);
+		} else if (pthread_cond_timedwait(&tw->idle_cond, &tw->idle_mutex, &deadline) == ETIMEDOUT) {
+			break;
+		}
+	}
+
+	tw->is_woken = false;
+
+	pthread_mutex_unlock(&tw->idle_mutex);
+}
+
+/**
+ * @brief Opaque helper. The thread routine on which the timer wheel runs
+ *
+ * Every tick is due at an absolute deadline derived from the wheel's epoch,
+ * so time spent invoking callbacks is never added to the schedule. Rather than
+ * waking on every tick, the thread sleeps until the next tick at which an
+ * occupied slot is due, and is woken early if a sooner event is registered.
+ * If the thread falls behind, all missed ticks are processed in a single
+ * catch-up batch.
+ *
+ * @param arg
+ * @return void*
+ */
+void* __timer_routine(void* arg) {
+	chron_timer_wheel_t* tw = (chron_timer_wheel_t*)arg;
+	uint64_t next;
+
+	while (atomic_load(&tw->is_running)) {
+		// producers need not wake us while we are awake...
+		atomic_store(&tw->next_wake_tick, 0);
+
+		// submissions made while we slept are applied before any tick is processed,
+		// so an el rescheduled meanwhile is not fired at its superseded deadline
+		__reschedule_slot(tw);
+
+		__advance_to_tick(tw, __tw_elapsed_ns(tw) / tw->tick_ns);
+
+		next = __next_due_tick(tw);
+
+		// ...a producer that submits after the drain either sees when we intend to
+		// wake, or its submission is seen here and we do not sleep at all
+		atomic_store(&tw->next_wake_tick, next);
+
+		if (!atomic_load(&tw->submissions)) {
+			__idle_until(tw, next);
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Opaque helper. Advance a manual wheel up to and including the given
+ * tick. Submissions are applied before each due tick is sought, so events
+ * registered by callbacks fire within the same call if they come due in time.
+ *
+ * @param tw
+ * @param target
+ * @return uint64_t number of events fired
+ */
+uint64_t __advance_manual(chron_timer_wheel_t* tw, uint64_t target) {
+	uint64_t n_fired = atomic_load_explicit(&tw->n_fired, memory_order_relaxed);
+	uint64_t next;
+
+	__reschedule_slot(tw);
+
+	while (CHRON_TW_GET_ABS_SLOT_N(tw) < target) {
+		next = __next_due_tick(tw);
+
+		__advance_to_tick(tw, next < target ? next : target);
+		__reschedule_slot(tw);
+	}
+
+	return atomic_load_explicit(&tw->n_fired, memory_order_relaxed) - n_fired;
+}
+
+/**
+ * @brief Opaque helper. Publish the tick at which a pollable wheel next needs
+ * processing, and arm its timerfd for it. If submissions arrived since they
+ * were last drained, the timerfd is made readable right away.
+ *
+ * @param tw
+ */
+void __poll_rearm(chron_timer_wheel_t* tw) {
+	uint64_t next = __next_due_tick(tw);
+
+	// pairs with __wake_if_sooner as in __timer_routine: a producer that submits
+	// after the drain either sees `next`, or its submission is seen here
+	atomic_store(&tw->next_wake_tick, next);
+
+	__poll_arm(tw, atomic_load(&tw->submissions) ? CHRON_TW_GET_ABS_SLOT_N(tw) : next);
+}
+
+/**
+ * @brief Opaque helper. Register a single event per its descriptor
+ *
+ * @param tw
+ * @param desc
+ * @return chron_tw_slot_el_t*
+ */
+chron_tw_slot_el_t* __register_ev(chron_timer_wheel_t* tw, const chron_tw_ev_desc_t* desc) {
+	if (!tw || !__desc_is_valid(desc)) return NULL;
+
+	chron_tw_slot_el_t* el = __slab_alloc(tw);
+
+	if (!el) return NULL;
+
+	if (tw->heap && !__tw_heap_reserve(tw, 1)) {
+		__slab_free(tw, el);
+		return NULL;
+	}
+
+	__el_init(tw, el, desc);
+	__reschedule_ev(tw, el, desc->interval, TW_CREATE);
+
+	atomic_fetch_add_explicit(&tw->n_slots, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&tw->n_scheduled, 1, memory_order_relaxed);
+
+	return el;
+}
+
+/* PUBLIC API */
+
+/**
+ * @brief Initialize a timer wheel, allocating memory for its slots
+ *
+ * @param size Size of the innermost ring buffer aka num of level 0 slots
+ * @param tick_interval tick interval in seconds
+ * @return chron_timer_wheel_t*
+ */
+chron_timer_wheel_t* chron_timer_wheel_init(int size, int tick_interval) {
+	chron_tw_opts_t opts = {
+		.size = size,
+		.tick_interval = tick_interval,
+		.resolution_ns = CHRON_NS_PER_S
+	};
+
+	return chron_timer_wheel_init_opts(&opts);
+}
 
-/* MACROS (opaque) */
+/**
+ * @brief Initialize a timer wheel with the given configuration
+ *
+ * @param opts
+ * @return chron_timer_wheel_t*
+ */
+chron_timer_wheel_t* chron_timer_wheel_init_opts(const chron_tw_opts_t* opts) {
+	if (!opts || opts->tick_interval <= 0 || opts->resolution_ns < 0) return NULL;
 
-/* Getters */
-#define CHRON_TW_GET_SLOT(tw, idx) (&(tw->slots[idx]))
+	if (opts->backend != TW_BACKEND_WHEEL && opts->backend != TW_BACKEND_HEAP && opts->backend != TW_BACKEND_ARRAY) return NULL;
 
-#define CHRON_TW_GET_SLOT_HEAD(tw, idx) (&(tw->slots[idx].linked_list))
+	if (opts->backend != TW_BACKEND_HEAP && opts->size <= 0) return NULL;
 
-#define CHRON_TW_GET_SLOT_MUTEX(tw, idx) (&(tw->slots[idx].mutex))
+	if (opts->is_pinned && (opts->cpu < 0 || opts->cpu >= CPU_SETSIZE)) return NULL;
 
-#define CHRON_TW_GET_UPTIME(tw) (CHRON_TW_GET_ABS_SLOT_N(tw) * tw->tick_interval)
+	// a manual or pollable wheel has no thread to pin, and runs every callback on the caller's
+	if ((opts->is_manual || opts->is_pollable) && (opts->is_pinned || opts->n_workers > 0)) return NULL;
 
-#define CHRON_TW_GET_SLOTS_AT_IDX(tw, idx) (&(tw->slots[idx]))
+	if (opts->is_manual && opts->is_pollable) return NULL;
 
-// the *absolute* slot number since the wheel routine began
-#define CHRON_TW_GET_ABS_SLOT_N(tw)	((tw->n_revolutions * tw->ring_size) + tw->current_tick)
+	// a heap wheel's slots are never used
+	int size = opts->backend == TW_BACKEND_HEAP ? 1 : opts->size;
+
+	chron_timer_wheel_t* tw = calloc(
+		1,
+		sizeof(chron_timer_wheel_t) +
+		(size + (CHRON_TW_N_LEVELS - 1) * CHRON_TW_LEVEL_SIZE) * sizeof(chron_tw_slot)
+	);
+
+	if (!tw) return NULL;
 
-#define CHRON_TW_GET_WAITLIST(tw) (&(tw->waitlist))
+	tw->tick_interval = opts->tick_interval;
+	tw->resolution_ns = opts->resolution_ns ? opts->resolution_ns : CHRON_NS_PER_S;
+	tw->tick_ns = (uint64_t)tw->tick_interval * tw->resolution_ns;
+	tw->ring_size = size;
+	tw->n_revolutions = 0;
+	tw->cpu = opts->is_pinned ? opts->cpu : -1;
+	tw->is_manual = opts->is_manual;
+	tw->is_pollable = opts->is_pollable;
+	tw->is_array = opts->backend == TW_BACKEND_ARRAY;
+	tw->fd = -1;
+
+	atomic_init(&tw->is_running, false);
+	atomic_init(&tw->next_worker, 0);
+
+	tw->occupancy = calloc(CHRON_TW_GET_N_OCCUPANCY_WORDS(tw), sizeof(uint64_t));
+	if (!tw->occupancy) {
+		free(tw);
+		return NULL;
+	}
 
-#define CHRON_TW_GET_WAITLIST_HEAD(tw) (&((CHRON_TW_GET_WAITLIST(tw))->linked_list))
+	if (!__slab_init(tw, opts->prealloc)) {
+		free(tw->occupancy);
+		free(tw);
+		return NULL;
+	}
 
-#define CHRON_TW_GET_SLOT_EMPTY(slot) (IS_GLTHREAD_EMPTY(&(slot->linked_list)))
+	if (!__pool_init(tw, opts->n_workers)) {
+		__slab_destroy(tw);
+		free(tw->occupancy);
+		free(tw);
+		return NULL;
+	}
 
-/* Setters */
-#define CHRON_TW_SET_LOCK_SLOT(slot) pthread_mutex_lock(&(slot->mutex))
+	if (opts->track_latency && !__latency_init(tw)) {
+		__pool_destroy(tw);
+		__slab_destroy(tw);
+		free(tw->occupancy);
+		free(tw);
+		return NULL;
+	}
 
-#define CHRON_TW_SET_UNLOCK_SLOT(slot) pthread_mutex_unlock(&(slot->mutex))
+	if (opts->backend == TW_BACKEND_HEAP && !__tw_heap_init(tw, opts->prealloc)) {
+		__latency_destroy(tw);
+		__pool_destroy(tw);
+		__slab_destroy(tw);
+		free(tw->occupancy);
+		free(tw);
+		return NULL;
+	}
 
-/* HELPERS */
+	if (opts->is_pollable && (tw->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+		__tw_heap_destroy(tw);
+		__latency_destroy(tw);
+		__pool_destroy(tw);
+		__slab_destroy(tw);
+		free(tw->occupancy);
+		free(tw);
+		return NULL;
+	}
+
+	atomic_init(&tw->submissions, NULL);
+	atomic_init(&tw->abs_tick, 0);
+	atomic_init(&tw->next_wake_tick, 0);
+
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+	pthread_mutex_init(&tw->idle_mutex, NULL);
+	pthread_cond_init(&tw->idle_cond, &attr);
+	tw->is_woken = false;
+
+	pthread_mutex_init(&tw->unheld_mutex, NULL);
+	pthread_cond_init(&tw->unheld_cond, NULL);
+
+	pthread_condattr_destroy(&attr);
+
+	// for each slot in each level of the wheel...
+	for (int i = 0; i < CHRON_TW_GET_N_SLOTS(tw); i++) {
+		glthread_init(CHRON_TW_GET_SLOT_HEAD(tw, i)); // initialize the slot's linked list
+		CHRON_TW_GET_SLOT(tw, i)->tail = NULL;
+		pthread_mutex_init(CHRON_TW_GET_SLOT_MUTEX(tw, i), NULL);
+	}
+
+	atomic_init(&tw->n_slots, 0);
+
+	return tw;
+}
 
 /**
- * @brief Insert a new event element in a given timer wheel slot
+ * @brief Start the timer wheel on a separate thread. Tick 0 is the moment of
+ * start. A pollable wheel gets no thread; its timerfd is armed instead.
  *
- * @param data1
- * @param data2
- * @return int
+ * @param tw
+ * @return bool false if the wheel is already running or is a manual wheel
  */
-int __insert_el_in_slot(void* data1, void* data2) {
-   chron_tw_slot_el_t* el1 = (chron_tw_slot_el_t* )data1;
-   chron_tw_slot_el_t* el2 = (chron_tw_slot_el_t* )data2;
-
-   if (el1->r < el2->r) return -1;
+bool chron_timer_wheel_start(chron_timer_wheel_t* tw) {
+	if (tw->is_manual || atomic_load(&tw->is_running)) return false;
 
-   if (el1->r > el2->r) return 1;
+	clock_gettime(CLOCK_MONOTONIC, &tw->epoch);
 
-   return 0;
-}
+	// the epoch is rebased so that the current tick is due right now
+	__tw_ns_to_timespec(
+		__tw_timespec_to_ns(&tw->epoch) - CHRON_TW_GET_ABS_SLOT_N(tw) * tw->tick_ns,
+		&tw->epoch
+	);
 
-void __reschedule_ev(
-	chron_timer_wheel_t* tw,
-	chron_tw_slot_el_t* el,
-	int next_interval,
-	chron_tw_opcode opcode
-) {
+	if (tw->is_pollable) {
+		atomic_store(&tw->is_running, true);
+		__poll_rearm(tw);
+		return true;
+	}
 
-switch(opcode){
-	case TW_CREATE:
-	case TW_RESCHEDULED:
-	case TW_DELETE:
+	if (!__pool_start(tw)) return false;
 
-		el->new_interval = next_interval;
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
 
-		CHRON_TW_SET_LOCK_SLOT(CHRON_TW_GET_WAITLIST(tw));
-		el->opcode = opcode;
+	if (tw->cpu >= 0) {
+		cpu_set_t cpus;
 
-		glthread_remove(&el->waitlist_node);
-		glthread_insert_after(
-			CHRON_TW_GET_WAITLIST_HEAD(tw),
-			&el->waitlist_node
-		);
+		CPU_ZERO(&cpus);
+		CPU_SET(tw->cpu, &cpus);
+		pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpus);
+	}
 
-		CHRON_TW_SET_UNLOCK_SLOT(CHRON_TW_GET_WAITLIST(tw));
-		break;
+	atomic_store(&tw->is_running, true);
 
-	default:
-		break;
+	if (pthread_create(&tw->thread, &attr, __timer_routine, (void*)tw)) {
+		pthread_attr_destroy(&attr);
+		atomic_store(&tw->is_running, false);
+		__pool_stop(tw);
+		return false;
 	}
 
+	pthread_attr_destroy(&attr);
+
+	return true;
 }
 
 /**
- * @brief Apply the offset node data in the glthread
+ * @brief Stop the timer wheel's thread, waiting for it and any workers to
+ * exit. Callbacks already queued on workers run before this returns. Scheduled
+ * events are retained and resume firing if the wheel is started again.
  *
- * @param glthread
- * @return chron_tw_slot_el_t*
+ * @param tw
  */
-chron_tw_slot_el_t* __glthread_to_el(glthread_t* glthread) {
-	return (chron_tw_slot_el_t*)((char*)(glthread) - (char*)&(((chron_tw_slot_el_t*)0)->waitlist_node));
+void chron_timer_wheel_stop(chron_timer_wheel_t* tw) {
+	if (!atomic_exchange(&tw->is_running, false)) return;
+
+	if (tw->is_pollable) {
+		atomic_store(&tw->next_wake_tick, 0);
+		__poll_settime(tw, CHRON_TW_NEVER);
+		return;
+	}
+
+	// the thread may be idling until its next due tick, or indefinitely
+	pthread_mutex_lock(&tw->idle_mutex);
+	tw->is_woken = true;
+	pthread_cond_signal(&tw->idle_cond);
+	pthread_mutex_unlock(&tw->idle_mutex);
+
+	pthread_join(tw->thread, NULL);
+	__pool_stop(tw);
 }
 
 /**
- * @brief
+ * @brief Stop the timer wheel and free it along with every event registered on it
  *
  * @param tw
  */
-void __reschedule_slot(chron_timer_wheel_t* tw) {
-	glthread_t* current_node;
-	chron_tw_slot_el_t* el;
+void chron_timer_wheel_destroy(chron_timer_wheel_t* tw) {
+	if (!tw) return;
 
-	// lock the waitlist
-	CHRON_TW_SET_LOCK_SLOT(CHRON_TW_GET_WAITLIST(tw));
+	chron_timer_wheel_stop(tw);
 
-	if (CHRON_TW_GET_SLOT_EMPTY(CHRON_TW_GET_WAITLIST(tw))) {
-		CHRON_TW_SET_UNLOCK_SLOT(CHRON_TW_GET_WAITLIST(tw));
-		return;
+	for (int i = 0; i < CHRON_TW_GET_N_SLOTS(tw); i++) {
+		pthread_mutex_destroy(CHRON_TW_GET_SLOT_MUTEX(tw, i));
 	}
 
-	ITERATE_GLTHREAD_BEGIN(CHRON_TW_GET_WAITLIST_HEAD(tw), current_node) {
-		el = __glthread_to_el(current_node);
-		glthread_remove(&el->linked_list_node);
-		el->slot_head = NULL;
-
-		switch (el->opcode) {
-			case TW_CREATE:
-			case TW_RESCHEDULED:
-				{
-					el->interval  = el->new_interval;
+	if (tw->is_array) __tw_array_destroy(tw, CHRON_TW_GET_N_SLOTS(tw));
 
-					int abs_slot_n = CHRON_TW_GET_ABS_SLOT_N(tw);
-					int next_abs_slot_n = abs_slot_n + (el->interval / tw->tick_interval);
-					int next_rev_n = next_abs_slot_n / tw->ring_size;
-					int next_slot_n = next_abs_slot_n & tw->ring_size;
+	pthread_mutex_destroy(&tw->idle_mutex);
+	pthread_cond_destroy(&tw->idle_cond);
+	pthread_mutex_destroy(&tw->unheld_mutex);
+	pthread_cond_destroy(&tw->unheld_cond);
 
-					el->r = next_rev_n;
-					el->slot_n = next_slot_n;
+	__pool_destroy(tw);
+	__latency_destroy(tw);
+	__tw_heap_destroy(tw);
 
-					glthread_priority_insert(
-						CHRON_TW_GET_SLOT_HEAD(tw, el->slot_n),
-						&el->linked_list_node,
-						__insert_el_in_slot,
-						(unsigned long)&((chron_tw_slot_el_t*)0)->linked_list_node
-					);
+	free(tw->batch);
+	free(tw->batch_args);
 
-					el->slot_head = CHRON_TW_GET_SLOT(tw, el->slot_n);
+	if (tw->fd >= 0) close(tw->fd);
 
-					glthread_remove(&el->waitlist_node);
-					el->n_scheduled++;
+	// every el lives in the slab, so this frees them all
+	__slab_destroy(tw);
+	free(tw->occupancy);
+	free(tw);
+}
 
-					if (el->opcode == TW_CREATE){
-						tw->n_slots++;
-					}
+/**
+ * @brief Read the timer wheel's counters. Safe to call from any thread while
+ * the wheel runs; each counter is read atomically, though not all at the same instant.
+ *
+ * @param tw
+ * @param stats
+ */
+void chron_timer_wheel_get_stats(chron_timer_wheel_t* tw, chron_tw_stats_t* stats) {
+	if (!tw || !stats) return;
 
-					el->opcode = TW_SCHEDULED;
-				}
-				break;
+	memset(stats, 0, sizeof(chron_tw_stats_t));
 
-			case TW_DELETE:
-				glthread_remove(&el->waitlist_node);
-				el->slot_head = NULL;
-				free(el);
+	stats->n_scheduled = atomic_load_explicit(&tw->n_scheduled, memory_order_relaxed);
+	stats->n_rescheduled = atomic_load_explicit(&tw->n_rescheduled, memory_order_relaxed);
+	stats->n_cancelled = atomic_load_explicit(&tw->n_cancelled, memory_order_relaxed);
+	stats->n_fired = atomic_load_explicit(&tw->n_fired, memory_order_relaxed);
+	stats->n_events = atomic_load_explicit(&tw->n_slots, memory_order_relaxed);
+	stats->waitlist_depth = atomic_load_explicit(&tw->n_waiting, memory_order_relaxed);
+	stats->n_ticks = atomic_load_explicit(&tw->n_ticks, memory_order_relaxed);
+	stats->n_ticks_missed = atomic_load_explicit(&tw->n_ticks_missed, memory_order_relaxed);
 
-				tw->n_slots--;
-				break;
+	for (int i = 0; i < CHRON_TW_GET_N_SLOTS(tw); i++) {
+		unsigned int n_els = atomic_load_explicit(&CHRON_TW_GET_SLOT(tw, i)->n_els, memory_order_relaxed);
 
-			default:
-				break;
-		}
-	} ITERATE_GLTHREAD_END(CHRON_TW_GET_WAITLIST_HEAD(tw), current_node);
+		if (n_els > stats->max_slot_len) stats->max_slot_len = n_els;
+	}
 
-	CHRON_TW_SET_UNLOCK_SLOT(CHRON_TW_GET_WAITLIST(tw));
+	if (tw->heap) {
+		stats->max_slot_len = atomic_load_explicit(&__tw_heap_slot(tw)->n_els, memory_order_relaxed);
+	}
 }
 
 /**
- * @brief Opaque helper. The thread routine on which the timer wheel runs
+ * @brief Get the time remaining until an event is next due, in ns. O(1), and
+ * safe to call from any thread while the wheel runs. Once the wheel is
+ * running, this is measured against the clock rather than the wheel's last
+ * processed tick, so it is precise to well within a tick.
  *
- * @param arg
- * @return void*
+ * @param tw
+ * @param el
+ * @return int64_t 0 if the event is due, -1 if it is not scheduled, e.g. a
+ * one-shot event that has fired
  */
-void* __timer_routine(void* arg) {
-	chron_timer_wheel_t* tw = (chron_timer_wheel_t*)arg;
-	chron_tw_slot_el_t* el = NULL;
+int64_t chron_timer_wheel_get_ns_remaining(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el) {
+	uint64_t due;
+	uint64_t now_ns;
 
-	int abs_slot_n = 0;
+	if (!tw || !el) return -1;
 
-	chron_tw_slot* slot = NULL;
-	glthread_t* current_node;
+	due = atomic_load(&el->due_tick);
+	if (!due) return -1;
 
-	while (true) {
-		tw->current_tick++;
+	if (atomic_load(&tw->is_running)) {
+		now_ns = __tw_elapsed_ns(tw);
+	} else {
+		now_ns = CHRON_TW_GET_ABS_SLOT_N(tw) * tw->tick_ns;
+	}
 
-		// start a new revolution, if necessary
-		if (tw->current_tick == tw->ring_size) {
-			tw->current_tick = 0;
-			tw->n_revolutions++;
-		}
+	return due * tw->tick_ns > now_ns ? (int64_t)(due * tw->tick_ns - now_ns) : 0;
+}
 
-		sleep(tw->tick_interval);
+/**
+ * @brief Get the time remaining until an event is next due, in the wheel's
+ * interval units (see `resolution_ns`). O(1), and safe to call from any thread.
+ *
+ * @param tw
+ * @param el
+ * @return int 0 if the event is due, -1 if it is not scheduled
+ */
+int chron_timer_wheel_get_time_remaining(chron_timer_wheel_t* tw, chron_tw_slot_el_t* el) {
+	int64_t ns = chron_timer_wheel_get_ns_remaining(tw, el);
 
-		// retrieve the current slot (linked list of event els)
-		slot = CHRON_TW_GET_SLOT(tw, tw->current_tick);
+	if (ns <= 0) return (int)ns;
 
-		// and the absolute slot number
-		abs_slot_n = CHRON_TW_GET_ABS_SLOT_N(tw);
+	// partial units are rounded up; 0 is reserved for an event that is due
+	return (int)((ns + tw->resolution_ns - 1) / tw->resolution_ns);
+}
 
-		/* now, we iterate the slot's linked list and
-			1) invoke those events which satisfy the criterion (the *r* value)
-			2) reschedule events that are marked as interval, or periodic
-				a) this process entails calculating the next slot for said events
-		*/
-		ITERATE_GLTHREAD_BEGIN(&slot->linked_list, current_node) {
-			el = __glthread_to_el(current_node);
+/**
+ * @brief Reset the timer wheel's clock to zero. Scheduled events, including
+ * those whose registration or reschedule is still queued, keep the number of
+ * ticks they had remaining. The wheel must be quiescent: a started wheel is
+ * refused, and no other thread may register, reschedule or advance it until
+ * this returns.
+ *
+ * @param tw
+ * @return bool false if the wheel is started
+ */
+bool chron_timer_wheel_reset(chron_timer_wheel_t* tw) {
+	glthread_t pending;
+	glthread_t* current_node;
+	chron_tw_slot_el_t* el;
+	uint64_t now;
 
-			// evaluate whether the current slot element's r variable == n revolutions
-			if (tw->n_revolutions == el->r) {
-				// if so, invoke the event...
-				el->callback(el->callback_arg, el->arg_size);
+	if (!tw || atomic_load(&tw->is_running)) return false;
 
-				// ...and check whether it needs to be rescheduled
-				if (el->is_recurring) {
-					// reschedule in the next slot
+	// queued deadlines are relative to the current clock, so place them first
+	__reschedule_slot(tw);
 
-					// get the next available slot
-					int next_abs_slot_n = abs_slot_n + (el->interval / tw->tick_interval);
+	now = CHRON_TW_GET_ABS_SLOT_N(tw);
 
-					// determine the next revolution
-					int next_revolution_n = next_abs_slot_n / tw->ring_size;
+	glthread_init(&pending);
 
-					// finally, the next slot number
-					int next_slot_n = next_abs_slot_n % tw->ring_size;
+	// the heap's order is unaffected by rebasing, so its els stay where they are
+	if (tw->heap) __tw_heap_rebase(tw, now);
 
-					el->r = next_revolution_n;
+	// collect every scheduled el, rebasing its deadline...
+	for (int i = 0; i < CHRON_TW_GET_N_SLOTS(tw); i++) {
+		while ((el = __slot_pop(CHRON_TW_GET_SLOT(tw, i)))) {
+			el->expires -= now;
+			atomic_store(&el->due_tick, el->expires);
+			glthread_insert_after(&pending, &el->linked_list_node);
+		}
+	}
 
-					// remove old linked list node and insert a new one
-					glthread_remove(&el->linked_list_node);
-					glthread_priority_insert(
-						CHRON_TW_GET_SLOT_HEAD(tw, next_slot_n),
-						&el->linked_list_node,
-						__insert_el_in_slot,
-						(unsigned long)&((chron_tw_slot_el_t*)0)->linked_list_node
-					);
+	// keep the tick driver's deadlines aligned with the rebased clock
+	__tw_ns_to_timespec(__tw_timespec_to_ns(&tw->epoch) + now * tw->tick_ns, &tw->epoch);
 
-					// assign head of the slot to which the element belongs
-					el->slot_head = CHRON_TW_GET_SLOT(tw, next_slot_n);
-					el->slot_n = next_slot_n;
+	__skip_to_tick(tw, 0);
 
-					el->n_scheduled++;
-				}
-			} else break;
-		} ITERATE_GLTHREAD_END(slot, current_node);
+	// ...and place it anew relative to the reset clock
+	ITERATE_GLTHREAD_BEGIN(&pending, current_node) {
+		el = __slot_glthread_to_el(current_node);
 
-	__reschedule_slot(tw);
-	}
+		glthread_remove(&el->linked_list_node);
+		__place_el(tw, el);
+		__el_unhold(el);
+	} ITERATE_GLTHREAD_END(&pending, current_node);
 
-	return NULL;
+	return true;
 }
 
-/* PUBLIC API */
+/**
+ * @brief Get the file descriptor of a pollable wheel, for use with poll, epoll
+ * and the like. It becomes readable once the wheel needs processing via
+ * chron_timer_wheel_process.
+ *
+ * @param tw
+ * @return int -1 if the wheel is not a pollable wheel
+ */
+int chron_timer_wheel_get_fd(chron_timer_wheel_t* tw) {
+	return tw ? tw->fd : -1;
+}
 
 /**
- * @brief Initialize a timer wheel, allocating memory for its slots
+ * @brief Process a started pollable wheel: apply pending registrations and run
+ * every event due by now on the calling thread, then re-arm the wheel's file
+ * descriptor for the next due tick. Only one thread may process a wheel at a
+ * time; any may register events.
  *
- * @param size Size of the internal ring buffer aka num of slots
- * @param tick_interval
- * @return chron_timer_wheel_t*
+ * @param tw
+ * @return uint64_t number of events fired, 0 if the wheel is not a started pollable wheel
  */
-chron_timer_wheel_t* chron_timer_wheel_init(int size, int tick_interval) {
-	chron_timer_wheel_t* tw = malloc(
-		// we want to calculate using the size of the linked list (slot) pointer
-		sizeof(chron_timer_wheel_t) + size * sizeof(chron_tw_slot*)
-	);
+uint64_t chron_timer_wheel_process(chron_timer_wheel_t* tw) {
+	uint64_t expirations;
+	uint64_t n_fired;
 
-	if (!tw) return NULL;
+	if (!tw || !tw->is_pollable || !atomic_load(&tw->is_running)) return 0;
 
-	tw->tick_interval = tick_interval;
-	tw->ring_size = size;
-	tw->n_revolutions = 0;
+	// clear the fd's readiness; it is nonblocking, so this fails harmlessly if it has not fired
+	if (read(tw->fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) return 0;
 
-	memset(&(tw->thread), 0, sizeof(chron_timer_wheel_t));
+	n_fired = atomic_load_explicit(&tw->n_fired, memory_order_relaxed);
 
-	// for each slot in the ring buffer...
-	for (int i = 0; i < size; i++) {
-		glthread_init(CHRON_TW_GET_SLOT_HEAD(tw, i)); // initialize the slot's linked list
-		pthread_mutex_init(CHRON_TW_GET_SLOT_MUTEX(tw, i), NULL);
-	}
+	// producers need not re-arm the fd while we are at it
+	atomic_store(&tw->next_wake_tick, 0);
 
-	tw->n_slots = 0;
+	__reschedule_slot(tw);
+	__advance_to_tick(tw, __tw_elapsed_ns(tw) / tw->tick_ns);
+	__reschedule_slot(tw);
 
-	return tw;
+	__poll_rearm(tw);
+
+	return atomic_load_explicit(&tw->n_fired, memory_order_relaxed) - n_fired;
 }
 
 /**
- * @brief Start the timer wheel on a separate thread
+ * @brief Advance a manual wheel's clock by the given number of ticks, invoking
+ * every event that comes due on the calling thread. Events fire in order of
+ * their deadlines, and ticks at which nothing is due are skipped outright, so
+ * the cost depends on the number of events fired rather than of ticks elapsed.
+ * Only one thread may advance a wheel at a time; any may register events.
  *
  * @param tw
- * @return bool
+ * @param ticks
+ * @return uint64_t number of events fired, 0 if the wheel is not a manual wheel
  */
-bool chron_timer_wheel_start(chron_timer_wheel_t* tw) {
-	if (pthread_create(&tw->thread, NULL, __timer_routine, (void*)tw)) {
-		return false;
-	}
+uint64_t chron_timer_wheel_advance(chron_timer_wheel_t* tw, uint64_t ticks) {
+	if (!tw || !tw->is_manual) return 0;
 
-	return true;
+	return __advance_manual(tw, CHRON_TW_GET_ABS_SLOT_N(tw) + ticks);
 }
 
 /**
- * @brief Reset the timer wheel
+ * @brief Advance a manual wheel's clock to the given time, as per
+ * chron_timer_wheel_advance. The clock never moves backward.
  *
  * @param tw
+ * @param time time since tick 0, in the wheel's interval units (see `resolution_ns`)
+ * @return uint64_t number of events fired, 0 if the wheel is not a manual wheel
  */
-void chron_timer_wheel_reset(chron_timer_wheel_t* tw) {
-	tw->current_tick = 0;
-	tw->n_revolutions = 0;
+uint64_t chron_timer_wheel_advance_to(chron_timer_wheel_t* tw, uint64_t time) {
+	if (!tw || !tw->is_manual) return 0;
+
+	return __advance_manual(tw, time / tw->tick_interval);
 }
 
 /**
@@ -324,28 +1861,231 @@ chron_tw_slot_el_t* chron_timer_wheel_register_ev(
 	int interval,
 	int recurring
 ) {
-	if (!tw || !callback) return NULL;
+	return chron_timer_wheel_register_ev_slack(tw, callback, arg, arg_size, interval, 0, recurring);
+}
 
-	chron_tw_slot_el_t* el = malloc(sizeof(chron_tw_slot_el_t));
+/**
+ * @brief Register a new event that may fire anywhere from `interval` to
+ * `interval + slack` out, and on each recurrence likewise. Events whose
+ * windows overlap are coalesced onto the same tick, so the wheel wakes once
+ * for all of them.
+ *
+ * @param tw
+ * @param callback
+ * @param arg
+ * @param arg_size
+ * @param interval
+ * @param slack in the same units as `interval`
+ * @param recurring
+ * @return chron_tw_slot_el_t*
+ */
+chron_tw_slot_el_t* chron_timer_wheel_register_ev_slack(
+	chron_timer_wheel_t* tw,
+	chron_tw_callback callback,
+	void* arg,
+	int arg_size,
+	int interval,
+	int slack,
+	int recurring
+) {
+	chron_tw_ev_desc_t desc = {
+		.callback = callback,
+		.arg = arg,
+		.arg_size = arg_size,
+		.interval = interval,
+		.recurring = recurring,
+		.slack = slack
+	};
+
+	return __register_ev(tw, &desc);
+}
 
-	el->callback = callback;
-	if (arg && arg_size){
-		el->callback_arg = arg;
-		el->arg_size = arg_size;
-  }
+/**
+ * @brief Register a new event whose expirations are delivered in batches.
+ * Every event registered with the same batch callback that comes due at a
+ * given tick is passed to a single invocation of it at the end of that tick,
+ * in the order they came due. Batch callbacks always run on the thread
+ * advancing the wheel, even in pool dispatch mode.
+ *
+ * @param tw
+ * @param batch_callback
+ * @param arg
+ * @param arg_size
+ * @param interval
+ * @param recurring
+ * @return chron_tw_slot_el_t*
+ */
+chron_tw_slot_el_t* chron_timer_wheel_register_ev_batched(
+	chron_timer_wheel_t* tw,
+	chron_tw_batch_callback batch_callback,
+	void* arg,
+	int arg_size,
+	int interval,
+	int recurring
+) {
+	chron_tw_ev_desc_t desc = {
+		.batch_callback = batch_callback,
+		.arg = arg,
+		.arg_size = arg_size,
+		.interval = interval,
+		.recurring = recurring
+	};
+
+	return __register_ev(tw, &desc);
+}
 
-	el->is_recurring = recurring;
-	glthread_init(&el->linked_list_node);
-	glthread_init(&el->waitlist_node);
+/**
+ * @brief Register a new event, copying its argument into the event itself
+ * rather than retaining the caller's pointer. The callback receives a pointer
+ * to the copy, valid for as long as the event is registered, so the caller
+ * need not allocate or keep an argument buffer of its own.
+ *
+ * @param tw
+ * @param callback
+ * @param arg
+ * @param arg_size at most CHRON_TW_INLINE_ARG_MAX bytes
+ * @param interval
+ * @param recurring
+ * @return chron_tw_slot_el_t* NULL if `arg_size` exceeds CHRON_TW_INLINE_ARG_MAX
+ */
+chron_tw_slot_el_t* chron_timer_wheel_register_ev_inline(
+	chron_timer_wheel_t* tw,
+	chron_tw_callback callback,
+	const void* arg,
+	int arg_size,
+	int interval,
+	int recurring
+) {
+	chron_tw_ev_desc_t desc = {
+		.callback = callback,
+		.arg = (void*)arg,
+		.arg_size = arg_size,
+		.interval = interval,
+		.recurring = recurring,
+		.is_arg_inline = true
+	};
+
+	return __register_ev(tw, &desc);
+}
 
-	el->n_scheduled = 0;
-	__reschedule_ev(tw, el, interval, TW_CREATE);
+/**
+ * @brief Register many events at once. Memory for the events is allocated in
+ * bulk and the whole batch is published to the wheel with a single atomic operation.
+ *
+ * @param tw
+ * @param descs descriptors of the events to register
+ * @param n number of descriptors
+ * @param els receives the `n` registered events, in descriptor order
+ * @return bool true only if every event was registered; if false, none were
+ */
+bool chron_timer_wheel_register_batch(
+	chron_timer_wheel_t* tw,
+	const chron_tw_ev_desc_t* descs,
+	int n,
+	chron_tw_slot_el_t** els
+) {
+	if (!tw || !descs || !els || n <= 0) return false;
 
-	return el;
+	for (int i = 0; i < n; i++) {
+		if (!__desc_is_valid(&descs[i])) return false;
+	}
+
+	if (!__slab_alloc_batch(tw, els, n)) return false;
+
+	if (tw->heap && !__tw_heap_reserve(tw, n)) {
+		for (int i = 0; i < n; i++) __slab_free(tw, els[i]);
+		return false;
+	}
+
+	uint64_t now = __tw_now_tick(tw);
+	uint64_t min_due = CHRON_TW_NEVER;
+
+	// the queue is a stack, so the batch is chained newest first to be applied in order
+	for (int i = 0; i < n; i++) {
+		uint64_t due = __deadline_tick(tw, now, descs[i].interval, descs[i].slack);
+
+		__el_init(tw, els[i], &descs[i]);
+		__submission_prepare(els[i], due, descs[i].interval, TW_CREATE);
+
+		els[i]->next_submission = i ? els[i - 1] : NULL;
+
+		if (due < min_due) min_due = due;
+	}
+
+	atomic_fetch_add_explicit(&tw->n_slots, n, memory_order_relaxed);
+	atomic_fetch_add_explicit(&tw->n_scheduled, n, memory_order_relaxed);
+
+	__submissions_push(tw, els[n - 1], els[0], n);
+	__wake_if_sooner(tw, min_due);
+
+	return true;
+}
+
+/**
+ * @brief Unregister many events at once. Every event is marked unregistered
+ * up front, so none of them fires from then on, and the wheel is handed a
+ * single chain of deletions to take them out of their slots the next time it
+ * drains its submissions. Once this returns, no callback of the events is
+ * running; they are waited for together, rather than one event at a time.
+ * An event already unregistered is left as it is.
+ *
+ * @param tw
+ * @param els
+ * @param n
+ */
+void chron_timer_wheel_unregister_batch(
+	chron_timer_wheel_t* tw,
+	chron_tw_slot_el_t** els,
+	int n
+) {
+	chron_tw_slot_el_t* first = NULL;
+	chron_tw_slot_el_t* last = NULL;
+	int n_queued = 0;
+	int n_deleted = 0;
+
+	if (!tw || !els || n <= 0) return;
+
+	for (int i = 0; i < n; i++) {
+		chron_tw_slot_el_t* el = els[i];
+
+		// ours, so the el outlives the wait below whoever unregistered it
+		atomic_fetch_add(&el->refs, 1);
+
+		if (atomic_exchange(&el->is_deleted, true)) continue;
+
+		atomic_store(&el->due_tick, 0);
+		n_deleted++;
+
+		// an el already queued carries the deletion in place of its pending operation
+		if (!__submission_prepare(el, 0, 0, TW_DELETE)) continue;
+
+		el->next_submission = first;
+		first = el;
+		if (!last) last = el;
+		n_queued++;
+	}
+
+	if (n_queued) __submissions_push(tw, first, last, n_queued);
+
+	if (n_deleted) {
+		atomic_fetch_sub_explicit(&tw->n_slots, n_deleted, memory_order_relaxed);
+		atomic_fetch_add_explicit(&tw->n_cancelled, n_deleted, memory_order_relaxed);
+	}
+
+	for (int i = 0; i < n; i++) {
+		__el_await_unheld(tw, els[i]);
+		__el_release(els[i]);
+	}
 }
 
 /**
- * @brief Unregister an event
+ * @brief Unregister an event. The event is removed from the wheel in O(1)
+ * before this returns, and its callback is neither running nor ever invoked
+ * again; unless this is called from the event's own callback, which is left
+ * to finish. Waiting for another callback to finish blocks on a condition
+ * variable. When two callbacks running at once unregister each other's events,
+ * the second to do so returns without waiting for the first, which is waiting
+ * on it.
  *
  * @param tw
  * @param el
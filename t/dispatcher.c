@@ -0,0 +1,182 @@
+#include "libchron.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Tests of TIMER_BACKEND_TIMERFD, whose timers are all delivered by the shared
+ * dispatcher thread: one-shot and periodic timers fire on time, timers with
+ * slack whose windows overlap share a single wakeup, and deleting a timer
+ * waits for a callback being delivered to return.
+ */
+
+/* timers given slack, due 2ms apart from 10ms out */
+#define TEST_N_SLACK 4
+
+/* slack given each of them, in ms */
+#define TEST_SLACK_MS 20
+
+/* how long the slow callback runs, in us */
+#define TEST_SLOW_US 50000
+
+typedef struct test_timer {
+	atomic_int n_fired;
+
+	/* CLOCK_MONOTONIC time of the last expiration, in ns */
+	_Atomic uint64_t fired_ns;
+} test_timer_t;
+
+static atomic_bool is_slow_running;
+
+static atomic_bool is_slow_done;
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * CHRON_NS_PER_S + ts.tv_nsec;
+}
+
+static void on_expiry(chron_timer_t* timer, void* arg) {
+	test_timer_t* t = arg;
+
+	(void)timer;
+
+	atomic_store(&t->fired_ns, now_ns());
+	atomic_fetch_add(&t->n_fired, 1);
+}
+
+static void on_slow_expiry(chron_timer_t* timer, void* arg) {
+	(void)timer;
+	(void)arg;
+
+	atomic_store(&is_slow_running, true);
+
+	usleep(TEST_SLOW_US);
+
+	atomic_store(&is_slow_done, true);
+}
+
+/**
+ * A one-shot timer fires once, no sooner than its deadline; a periodic timer
+ * fires once per interval until cancelled
+ */
+static void test_delivery(void) {
+	test_timer_t once = { 0 };
+	test_timer_t periodic = { 0 };
+	chron_timer_t* once_timer;
+	chron_timer_t* periodic_timer;
+	uint64_t start_ns;
+	int n_fired;
+
+	once_timer = chron_timer_init(on_expiry, &once, 10, 0, 0, false);
+	periodic_timer = chron_timer_init(on_expiry, &periodic, 5, 5, 0, false);
+	assert(once_timer && periodic_timer);
+
+	start_ns = now_ns();
+
+	chron_timer_start(once_timer);
+	chron_timer_start(periodic_timer);
+
+	usleep(100000);
+
+	assert(atomic_load(&once.n_fired) == 1);
+	assert(atomic_load(&once.fired_ns) >= start_ns + 10 * CHRON_NS_PER_MS);
+
+	n_fired = atomic_load(&periodic.n_fired);
+	assert(n_fired >= 5 && n_fired <= 20);
+
+	assert(chron_timer_cancel(periodic_timer));
+
+	// a callback already under way may still complete
+	usleep(10000);
+	n_fired = atomic_load(&periodic.n_fired);
+
+	usleep(30000);
+	assert(atomic_load(&periodic.n_fired) == n_fired);
+
+	assert(chron_timer_delete(once_timer));
+	assert(chron_timer_delete(periodic_timer));
+
+	free(once_timer);
+	free(periodic_timer);
+}
+
+/**
+ * Timers with staggered deadlines whose slack windows overlap are delivered
+ * together, each within its own window
+ */
+static void test_slack(void) {
+	test_timer_t ts[TEST_N_SLACK] = { 0 };
+	chron_timer_t* timers[TEST_N_SLACK];
+	uint64_t start_ns;
+	uint64_t first_ns = UINT64_MAX;
+	uint64_t last_ns = 0;
+
+	for (int i = 0; i < TEST_N_SLACK; i++) {
+		timers[i] = chron_timer_init(on_expiry, &ts[i], 10 + i * 2, 0, 0, false);
+		assert(timers[i]);
+
+		assert(chron_timer_set_slack(timers[i], TEST_SLACK_MS));
+	}
+
+	start_ns = now_ns();
+
+	for (int i = 0; i < TEST_N_SLACK; i++) chron_timer_start(timers[i]);
+
+	usleep(100000);
+
+	for (int i = 0; i < TEST_N_SLACK; i++) {
+		uint64_t fired_ns = atomic_load(&ts[i].fired_ns);
+
+		assert(atomic_load(&ts[i].n_fired) == 1);
+		assert(fired_ns >= start_ns + (uint64_t)(10 + i * 2) * CHRON_NS_PER_MS);
+
+		if (fired_ns < first_ns) first_ns = fired_ns;
+		if (fired_ns > last_ns) last_ns = fired_ns;
+	}
+
+	// delivered one after another on a single wakeup, rather than 6ms apart
+	assert(last_ns - first_ns < 2 * CHRON_NS_PER_MS);
+
+	for (int i = 0; i < TEST_N_SLACK; i++) {
+		assert(chron_timer_delete(timers[i]));
+		free(timers[i]);
+	}
+}
+
+/**
+ * Deleting a timer whose callback is being delivered returns only once the
+ * callback has
+ */
+static void test_delete_waits(void) {
+	chron_timer_t* timer;
+
+	timer = chron_timer_init(on_slow_expiry, NULL, 1, 0, 0, false);
+	assert(timer);
+
+	chron_timer_start(timer);
+
+	while (!atomic_load(&is_slow_running)) usleep(100);
+
+	assert(chron_timer_delete(timer));
+	assert(atomic_load(&is_slow_done));
+
+	free(timer);
+}
+
+int main(int argc, char* argv[]) {
+	(void)argc;
+	(void)argv;
+
+	chron_timer_set_backend(TIMER_BACKEND_TIMERFD);
+
+	test_delivery();
+	test_slack();
+	test_delete_waits();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+#include "libchron.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * Tests of the number of kernel timer programmings per operation on a
+ * TIMER_BACKEND_POSIX chron_timer_t, as counted by chron_timer_get_stats: each
+ * operation re-arms the timer with a single timer_settime, without disarming it
+ * first, and expirations program it only when a backoff re-arms it.
+ */
+
+static atomic_int n_fired;
+
+static void on_expiry(chron_timer_t* timer, void* arg) {
+	(void)timer;
+	(void)arg;
+
+	atomic_fetch_add(&n_fired, 1);
+}
+
+static uint64_t n_settime(void) {
+	chron_timer_stats_t stats;
+
+	chron_timer_get_stats(&stats);
+
+	return stats.n_settime;
+}
+
+/**
+ * Starting, restarting, rescheduling, cancelling and toggling a timer each take
+ * a single timer_settime
+ */
+static void test_ops(void) {
+	chron_timer_t* timer;
+	uint64_t n;
+
+	timer = chron_timer_init(on_expiry, NULL, 10000, 10000, 0, false);
+	assert(timer);
+
+	n = n_settime();
+
+	chron_timer_start(timer);
+	assert(n_settime() == n + 1);
+
+	assert(chron_timer_restart(timer));
+	assert(n_settime() == n + 2);
+
+	assert(chron_timer_reschedule(timer, 20000, 0));
+	assert(n_settime() == n + 3);
+
+	assert(chron_timer_cancel(timer));
+	assert(n_settime() == n + 4);
+
+	assert(chron_timer_toggle(timer));
+	assert(n_settime() == n + 5);
+
+	assert(chron_timer_delete(timer));
+	assert(n_settime() == n + 5);
+
+	free(timer);
+}
+
+/**
+ * A periodic timer's expirations program nothing; each expiration of an
+ * exponential timer re-arms it with a single timer_settime, and the last
+ * disarms it with another
+ */
+static void test_expirations(void) {
+	chron_timer_t* timer;
+	uint64_t n;
+
+	timer = chron_timer_init(on_expiry, NULL, 2, 2, 0, false);
+	assert(timer);
+
+	n = n_settime();
+
+	chron_timer_start(timer);
+	usleep(50000);
+	assert(chron_timer_cancel(timer));
+
+	assert(atomic_load(&n_fired) > 1);
+	assert(n_settime() == n + 2);
+
+	assert(chron_timer_delete(timer));
+
+	// the last callback thread may still be returning
+	usleep(10000);
+	free(timer);
+
+	atomic_store(&n_fired, 0);
+
+	// fires at 2, 6 and 14ms, re-arming for 4, 8 and 16ms, and is disarmed at 30ms
+	timer = chron_timer_init(on_expiry, NULL, 2, 0, 3, true);
+	assert(timer);
+
+	n = n_settime();
+
+	chron_timer_start(timer);
+	usleep(100000);
+
+	assert(atomic_load(&n_fired) == 3);
+	assert(n_settime() == n + 1 + 3 + 1);
+
+	assert(chron_timer_delete(timer));
+
+	usleep(10000);
+	free(timer);
+}
+
+int main(int argc, char* argv[]) {
+	(void)argc;
+	(void)argv;
+
+	chron_timer_set_backend(TIMER_BACKEND_POSIX);
+
+	test_ops();
+	test_expirations();
+
+	return EXIT_SUCCESS;
+}
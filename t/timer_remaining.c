@@ -0,0 +1,140 @@
+#include "libchron.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * Tests of chron_timer_get_ms_remaining on every backend: it counts down to
+ * the deadline recorded when the timer was armed, follows a periodic timer
+ * past its first expiration, and readers racing a thread that keeps re-arming
+ * the timer always read one deadline or another, never a torn one.
+ */
+
+#define TEST_N_READERS 3
+
+#define TEST_N_REARMS 20000
+
+static atomic_bool is_rearming;
+
+/* readings that matched neither deadline */
+static atomic_long n_torn;
+
+static void on_expiry(chron_timer_t* timer, void* arg) {
+	(void)timer;
+	(void)arg;
+}
+
+static void* reader(void* arg) {
+	chron_timer_t* timer = arg;
+
+	while (atomic_load(&is_rearming)) {
+		unsigned long ms = chron_timer_get_ms_remaining(timer);
+
+		if (!ms || ms > 5000) atomic_fetch_add(&n_torn, 1);
+	}
+
+	return NULL;
+}
+
+/**
+ * The time remaining counts down from the deadline, and is derived from the
+ * period once a periodic timer has expired
+ */
+static void test_countdown(void) {
+	chron_timer_t* once;
+	chron_timer_t* periodic;
+	unsigned long ms;
+
+	once = chron_timer_init(on_expiry, NULL, 1000, 0, 0, false);
+	periodic = chron_timer_init(on_expiry, NULL, 10, 20, 0, false);
+	assert(once && periodic);
+
+	chron_timer_start(once);
+	chron_timer_start(periodic);
+
+	ms = chron_timer_get_ms_remaining(once);
+	assert(ms > 900 && ms <= 1000);
+
+	usleep(100000);
+
+	ms = chron_timer_get_ms_remaining(once);
+	assert(ms > 500 && ms <= 900);
+
+	assert(chron_timer_get_ms_remaining(periodic) <= 20);
+
+	// pausing keeps what was left, and the timer picks up from there
+	assert(chron_timer_pause(once));
+	assert(once->time_remaining > 500 && once->time_remaining <= 900);
+
+	assert(chron_timer_resume(once));
+	ms = chron_timer_get_ms_remaining(once);
+	assert(ms > 400 && ms <= 900);
+
+	assert(chron_timer_cancel(once));
+	assert(chron_timer_get_ms_remaining(once) == (unsigned long)-1);
+
+	assert(chron_timer_delete(once));
+	assert(chron_timer_delete(periodic));
+
+	// a POSIX timer's last callback thread may still be returning
+	usleep(10000);
+
+	free(once);
+	free(periodic);
+}
+
+/**
+ * Readers of the time remaining, racing a thread re-arming the timer for
+ * either of two deadlines, read one of them every time
+ */
+static void test_readers(void) {
+	chron_timer_t* timer;
+	pthread_t readers[TEST_N_READERS];
+
+	timer = chron_timer_init(on_expiry, NULL, 1000, 0, 0, false);
+	assert(timer);
+
+	chron_timer_start(timer);
+
+	atomic_store(&n_torn, 0);
+	atomic_store(&is_rearming, true);
+
+	for (int i = 0; i < TEST_N_READERS; i++) {
+		if (pthread_create(&readers[i], NULL, reader, timer)) abort();
+	}
+
+	for (int i = 0; i < TEST_N_REARMS; i++) {
+		if (!chron_timer_reschedule(timer, i % 2 ? 5000 : 1000, 0)) abort();
+	}
+
+	atomic_store(&is_rearming, false);
+
+	for (int i = 0; i < TEST_N_READERS; i++) pthread_join(readers[i], NULL);
+
+	assert(atomic_load(&n_torn) == 0);
+
+	assert(chron_timer_delete(timer));
+
+	free(timer);
+}
+
+int main(int argc, char* argv[]) {
+	static const chron_timer_backend backends[] = {
+		TIMER_BACKEND_POSIX,
+		TIMER_BACKEND_TIMERFD,
+		TIMER_BACKEND_WHEEL
+	};
+
+	(void)argc;
+	(void)argv;
+
+	for (int i = 0; i < (int)(sizeof(backends) / sizeof(backends[0])); i++) {
+		chron_timer_set_backend(backends[i]);
+
+		test_countdown();
+		test_readers();
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,197 @@
+#include "libchron.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * Tests of chron_timer_t's state machine, on every backend: each operation is
+ * accepted from the states it always was, and operations racing each other
+ * and the expiry path leave the kernel timer armed as the last one left it.
+ */
+
+/* threads applying operations to the same timers at once */
+#define TEST_N_THREADS 4
+
+#define TEST_N_TIMERS 8
+
+#define TEST_N_OPS 2000
+
+static atomic_long n_fired;
+
+static void on_expiry(chron_timer_t* timer, void* arg) {
+	(void)timer;
+	(void)arg;
+
+	atomic_fetch_add(&n_fired, 1);
+}
+
+static chron_timer_state state_of(chron_timer_t* timer) {
+	return atomic_load(&timer->timer_state);
+}
+
+/**
+ * Pause and resume are refused only from the state they lead to, cancel and
+ * re-arming only from one never started, and every operation once deleted
+ */
+static void test_transitions(chron_timer_backend backend) {
+	chron_timer_t* timer;
+
+	chron_timer_set_backend(backend);
+
+	timer = chron_timer_init(on_expiry, NULL, 10000, 0, 0, false);
+	assert(timer);
+
+	assert(!chron_timer_cancel(timer));
+	assert(!chron_timer_restart(timer));
+	assert(!chron_timer_reschedule(timer, 10000, 0));
+	assert(state_of(timer) == TIMER_INIT);
+
+	assert(chron_timer_pause(timer));
+	assert(state_of(timer) == TIMER_PAUSED);
+	assert(!chron_timer_pause(timer));
+
+	assert(chron_timer_resume(timer));
+	assert(state_of(timer) == TIMER_RESUMED);
+	assert(!chron_timer_resume(timer));
+
+	assert(chron_timer_cancel(timer));
+	assert(state_of(timer) == TIMER_CANCELLED);
+
+	assert(chron_timer_pause(timer));
+	assert(chron_timer_cancel(timer));
+	assert(chron_timer_resume(timer));
+
+	assert(chron_timer_restart(timer));
+	assert(state_of(timer) == TIMER_RUNNING);
+	assert(chron_timer_get_ms_remaining(timer) > 9000);
+
+	assert(chron_timer_pause(timer));
+	assert(timer->time_remaining > 9000);
+
+	chron_timer_start(timer);
+	assert(state_of(timer) == TIMER_RUNNING);
+
+	assert(chron_timer_resume(timer));
+	assert(state_of(timer) == TIMER_RESUMED);
+
+	assert(chron_timer_delete(timer));
+	assert(state_of(timer) == TIMER_DELETED);
+
+	assert(!chron_timer_pause(timer));
+	assert(!chron_timer_resume(timer));
+	assert(!chron_timer_cancel(timer));
+	assert(!chron_timer_restart(timer));
+	assert(!chron_timer_reschedule(timer, 1, 0));
+	assert(!chron_timer_toggle(timer));
+	assert(!chron_timer_delete(timer));
+
+	chron_timer_start(timer);
+	assert(state_of(timer) == TIMER_DELETED);
+
+	free(timer);
+}
+
+static void* race(void* arg) {
+	chron_timer_t** timers = arg;
+	unsigned int seed = (unsigned int)(uintptr_t)timers[TEST_N_TIMERS];
+
+	for (int i = 0; i < TEST_N_OPS; i++) {
+		chron_timer_t* timer = timers[rand_r(&seed) % TEST_N_TIMERS];
+
+		switch (rand_r(&seed) % 5) {
+			case 0:
+				chron_timer_pause(timer);
+				break;
+			case 1:
+				chron_timer_resume(timer);
+				break;
+			case 2:
+				chron_timer_cancel(timer);
+				break;
+			case 3:
+				chron_timer_restart(timer);
+				break;
+			default:
+				chron_timer_reschedule(timer, 1, 1);
+				break;
+		}
+
+		// let the timers fire between bursts
+		if (!(i % 50)) usleep(1000 + rand_r(&seed) % 1000);
+	}
+
+	return NULL;
+}
+
+/**
+ * Once threads pausing, resuming, cancelling and re-arming 1ms periodic timers
+ * as they fire are done, cancelling the timers stops them for good
+ */
+static void test_contention(chron_timer_backend backend) {
+	chron_timer_t* timers[TEST_N_TIMERS];
+	chron_timer_t* args[TEST_N_THREADS][TEST_N_TIMERS + 1];
+	pthread_t threads[TEST_N_THREADS];
+	long n_cancelled;
+
+	chron_timer_set_backend(backend);
+
+	for (int i = 0; i < TEST_N_TIMERS; i++) {
+		timers[i] = chron_timer_init(on_expiry, NULL, 1, 1, 0, false);
+		assert(timers[i]);
+
+		chron_timer_start(timers[i]);
+	}
+
+	for (int i = 0; i < TEST_N_THREADS; i++) {
+		for (int j = 0; j < TEST_N_TIMERS; j++) args[i][j] = timers[j];
+
+		// each thread's seed rides after its timers
+		args[i][TEST_N_TIMERS] = (chron_timer_t*)(uintptr_t)(i + 1);
+
+		if (pthread_create(&threads[i], NULL, race, args[i])) abort();
+	}
+
+	for (int i = 0; i < TEST_N_THREADS; i++) pthread_join(threads[i], NULL);
+
+	for (int i = 0; i < TEST_N_TIMERS; i++) {
+		assert(chron_timer_cancel(timers[i]));
+		assert(state_of(timers[i]) == TIMER_CANCELLED);
+	}
+
+	// let callbacks already under way finish
+	usleep(20000);
+
+	n_cancelled = atomic_load(&n_fired);
+
+	usleep(50000);
+
+	assert(atomic_load(&n_fired) == n_cancelled);
+
+	for (int i = 0; i < TEST_N_TIMERS; i++) assert(chron_timer_delete(timers[i]));
+
+	// a POSIX timer's last callback thread may still be returning
+	usleep(10000);
+
+	for (int i = 0; i < TEST_N_TIMERS; i++) free(timers[i]);
+}
+
+int main(int argc, char* argv[]) {
+	static const chron_timer_backend backends[] = {
+		TIMER_BACKEND_POSIX,
+		TIMER_BACKEND_TIMERFD,
+		TIMER_BACKEND_WHEEL
+	};
+
+	(void)argc;
+	(void)argv;
+
+	for (int i = 0; i < (int)(sizeof(backends) / sizeof(backends[0])); i++) {
+		test_transitions(backends[i]);
+		test_contention(backends[i]);
+	}
+
+	assert(atomic_load(&n_fired) > 0);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+#include "libchron.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * Several threads create 1ms periodic TIMER_BACKEND_WHEEL timers, arm and
+ * re-arm them while they fire, and delete them, as busy threads compete for
+ * the CPU. A timer's first expiration may run on the wheel thread before the
+ * thread arming it is scheduled again, so it must find the timer's event
+ * already published.
+ */
+
+#define TEST_N_ARMERS 4
+
+/* threads spinning to preempt the armers and the wheel thread */
+#define TEST_N_LOADERS 4
+
+/* timers created by each armer at a time */
+#define TEST_N_TIMERS 32
+
+#define TEST_N_ROUNDS 100
+
+static atomic_long n_fired;
+
+static atomic_bool is_loading;
+
+static void on_expiry(chron_timer_t* timer, void* arg) {
+	(void)timer;
+	(void)arg;
+
+	atomic_fetch_add(&n_fired, 1);
+}
+
+static void* loader(void* arg) {
+	volatile unsigned long n = 0;
+
+	(void)arg;
+
+	while (atomic_load(&is_loading)) n++;
+
+	return NULL;
+}
+
+static void* armer(void* arg) {
+	unsigned int seed = (unsigned int)(uintptr_t)arg;
+	chron_timer_t* timers[TEST_N_TIMERS];
+
+	for (int round = 0; round < TEST_N_ROUNDS; round++) {
+		for (int i = 0; i < TEST_N_TIMERS; i++) {
+			timers[i] = chron_timer_init(on_expiry, NULL, 1, 1, 0, false);
+			if (!timers[i]) abort();
+
+			chron_timer_start(timers[i]);
+		}
+
+		usleep(rand_r(&seed) % 2000);
+
+		for (int i = 0; i < TEST_N_TIMERS; i++) {
+			if (!chron_timer_reschedule(timers[i], 1, 1)) abort();
+		}
+
+		usleep(rand_r(&seed) % 2000);
+
+		for (int i = 0; i < TEST_N_TIMERS; i++) {
+			if (!chron_timer_delete(timers[i])) abort();
+
+			free(timers[i]);
+		}
+	}
+
+	return NULL;
+}
+
+int main(int argc, char* argv[]) {
+	pthread_t armers[TEST_N_ARMERS];
+	pthread_t loaders[TEST_N_LOADERS];
+
+	(void)argc;
+	(void)argv;
+
+	chron_timer_set_backend(TIMER_BACKEND_WHEEL);
+
+	atomic_store(&is_loading, true);
+
+	for (int i = 0; i < TEST_N_LOADERS; i++) {
+		if (pthread_create(&loaders[i], NULL, loader, NULL)) abort();
+	}
+
+	for (int i = 0; i < TEST_N_ARMERS; i++) {
+		if (pthread_create(&armers[i], NULL, armer, (void*)(uintptr_t)(i + 1))) abort();
+	}
+
+	for (int i = 0; i < TEST_N_ARMERS; i++) pthread_join(armers[i], NULL);
+
+	atomic_store(&is_loading, false);
+
+	for (int i = 0; i < TEST_N_LOADERS; i++) pthread_join(loaders[i], NULL);
+
+	assert(atomic_load(&n_fired) > 0);
+
+	return EXIT_SUCCESS;
+}
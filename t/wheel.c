@@ -0,0 +1,475 @@
+#include "libchron.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+/**
+ * Deterministic tests of chron_timer_wheel_t, driven through a manual wheel's
+ * clock with chron_timer_wheel_advance. Each test runs against every backend.
+ */
+
+/* number of level 0 slots; level k then spans TEST_SIZE * 64^k ticks */
+#define TEST_SIZE 64
+
+/* expirations recorded per event */
+#define TEST_MAX_FIRED 16
+
+typedef struct test_ev {
+	/* ticks at which the event fired */
+	uint64_t fired_at[TEST_MAX_FIRED];
+
+	int n_fired;
+} test_ev_t;
+
+/* the wheel under test, whose clock the callbacks read */
+static chron_timer_wheel_t* tw;
+
+/* sizes of the batches delivered, in order */
+static int batch_sizes[TEST_MAX_FIRED];
+
+static int n_batches;
+
+/* event rescheduled by on_defer_expiry */
+static chron_tw_slot_el_t* deferred_el;
+
+static void on_expiry(void* arg, int arg_size) {
+	test_ev_t* ev = arg;
+
+	assert(arg_size == sizeof(test_ev_t));
+	assert(ev->n_fired < TEST_MAX_FIRED);
+
+	ev->fired_at[ev->n_fired++] = atomic_load(&tw->abs_tick);
+}
+
+static void on_defer_expiry(void* arg, int arg_size) {
+	on_expiry(arg, arg_size);
+
+	chron_timer_wheel_reschedule_ev(tw, deferred_el, 20);
+}
+
+static void on_batch(void** args, int n_args) {
+	assert(n_batches < TEST_MAX_FIRED);
+
+	batch_sizes[n_batches++] = n_args;
+
+	for (int i = 0; i < n_args; i++) on_expiry(args[i], sizeof(test_ev_t));
+}
+
+static void setup(chron_tw_backend backend) {
+	chron_tw_opts_t opts = {
+		.size = TEST_SIZE,
+		.tick_interval = 1,
+		.is_manual = true,
+		.backend = backend
+	};
+
+	n_batches = 0;
+
+	tw = chron_timer_wheel_init_opts(&opts);
+	assert(tw);
+}
+
+static void teardown(void) {
+	chron_timer_wheel_destroy(tw);
+	tw = NULL;
+}
+
+static chron_tw_slot_el_t* register_ev(test_ev_t* ev, int interval, int recurring) {
+	chron_tw_slot_el_t* el = chron_timer_wheel_register_ev(
+		tw,
+		on_expiry,
+		ev,
+		sizeof(test_ev_t),
+		interval,
+		recurring
+	);
+
+	assert(el);
+
+	return el;
+}
+
+/**
+ * Events on either side of each level's range, and beyond the outermost
+ * level, fire exactly once, at the tick they are due
+ */
+static void test_levels(chron_tw_backend backend) {
+	static const int intervals[] = {
+		1, TEST_SIZE - 1,
+		TEST_SIZE, 100,
+		TEST_SIZE * 64 - 1, TEST_SIZE * 64, 5000,
+		TEST_SIZE * 64 * 64 - 1, TEST_SIZE * 64 * 64, 300000,
+		TEST_SIZE * 64 * 64 * 64 - 1, TEST_SIZE * 64 * 64 * 64, 20000000,
+		// the outermost level's range, and beyond it
+		TEST_SIZE * 64 * 64 * 64 * 64 - 1, TEST_SIZE * 64 * 64 * 64 * 64, 2000000000
+	};
+	enum { N = sizeof(intervals) / sizeof(intervals[0]) };
+	test_ev_t evs[N] = { 0 };
+	uint64_t n_fired;
+
+	setup(backend);
+
+	for (int i = 0; i < N; i++) register_ev(&evs[i], intervals[i], 0);
+
+	n_fired = chron_timer_wheel_advance(tw, 2100000000ULL);
+	assert(n_fired == N);
+
+	for (int i = 0; i < N; i++) {
+		assert(evs[i].n_fired == 1);
+		assert(evs[i].fired_at[0] == (uint64_t)intervals[i]);
+	}
+
+	teardown();
+}
+
+/**
+ * Events due at the same tick from different levels fire together once
+ * the outer ones have cascaded, even if the wheel was advanced part way
+ */
+static void test_cascade(chron_tw_backend backend) {
+	test_ev_t near = { 0 };
+	test_ev_t far = { 0 };
+	uint64_t n_fired;
+
+	setup(backend);
+
+	chron_timer_wheel_advance(tw, 1000);
+
+	register_ev(&far, 10000, 0);
+	chron_timer_wheel_advance(tw, 9000 - 1);
+	register_ev(&near, 1000 + 1, 0);
+
+	n_fired = chron_timer_wheel_advance(tw, 1000);
+	assert(n_fired == 0);
+	n_fired = chron_timer_wheel_advance(tw, 1);
+	assert(n_fired == 2);
+	assert(near.fired_at[0] == 11000 && far.fired_at[0] == 11000);
+
+	teardown();
+}
+
+/**
+ * Recurring events fire once per interval, relative to the tick at which
+ * they last fired, until unregistered
+ */
+static void test_recurring(chron_tw_backend backend) {
+	test_ev_t ev = { 0 };
+	test_ev_t slow = { 0 };
+	chron_tw_slot_el_t* el;
+	uint64_t n_fired;
+
+	setup(backend);
+
+	el = register_ev(&ev, 10, 1);
+	register_ev(&slow, 100, 1);
+
+	n_fired = chron_timer_wheel_advance(tw, 95);
+	assert(n_fired == 9);
+	assert(ev.n_fired == 9);
+
+	for (int i = 0; i < ev.n_fired; i++) assert(ev.fired_at[i] == (uint64_t)(i + 1) * 10);
+
+	chron_timer_wheel_unregister_ev(tw, el);
+
+	n_fired = chron_timer_wheel_advance(tw, 205);
+	assert(n_fired == 3);
+	assert(ev.n_fired == 9);
+	assert(slow.n_fired == 3 && slow.fired_at[0] == 100 && slow.fired_at[2] == 300);
+
+	teardown();
+}
+
+/**
+ * A rescheduled event fires once, relative to the tick at which it was
+ * rescheduled; an unregistered event never fires
+ */
+static void test_reschedule_unregister(chron_tw_backend backend) {
+	test_ev_t sooner = { 0 };
+	test_ev_t later = { 0 };
+	test_ev_t twice = { 0 };
+	test_ev_t gone = { 0 };
+	chron_tw_slot_el_t* sooner_el;
+	chron_tw_slot_el_t* later_el;
+	chron_tw_slot_el_t* twice_el;
+	chron_tw_slot_el_t* gone_el;
+	uint64_t n_fired;
+
+	setup(backend);
+
+	sooner_el = register_ev(&sooner, 5000, 0);
+	later_el = register_ev(&later, 40, 0);
+	twice_el = register_ev(&twice, 30, 0);
+	gone_el = register_ev(&gone, 30, 0);
+
+	chron_timer_wheel_reschedule_ev(tw, sooner_el, 20);
+
+	chron_timer_wheel_advance(tw, 10);
+
+	chron_timer_wheel_reschedule_ev(tw, later_el, 100);
+	chron_timer_wheel_unregister_ev(tw, gone_el);
+
+	// only the last of several pending reschedules applies
+	chron_timer_wheel_reschedule_ev(tw, twice_el, 5);
+	chron_timer_wheel_reschedule_ev(tw, twice_el, 50);
+
+	n_fired = chron_timer_wheel_advance(tw, 10000);
+	assert(n_fired == 3);
+
+	assert(sooner.n_fired == 1 && sooner.fired_at[0] == 20);
+	assert(later.n_fired == 1 && later.fired_at[0] == 110);
+	assert(twice.n_fired == 1 && twice.fired_at[0] == 60);
+	assert(gone.n_fired == 0);
+
+	teardown();
+}
+
+/**
+ * Events whose windows overlap are coalesced onto a single tick within
+ * each of their windows; events with no slack are not
+ */
+static void test_slack(chron_tw_backend backend) {
+	static const int windows[][2] = { { 100, 50 }, { 120, 20 }, { 97, 40 } };
+	enum { N = sizeof(windows) / sizeof(windows[0]) };
+	test_ev_t evs[N] = { 0 };
+	test_ev_t exact = { 0 };
+	uint64_t n_fired;
+
+	setup(backend);
+
+	for (int i = 0; i < N; i++) {
+		chron_tw_slot_el_t* el = chron_timer_wheel_register_ev_slack(
+			tw,
+			on_expiry,
+			&evs[i],
+			sizeof(test_ev_t),
+			windows[i][0],
+			windows[i][1],
+			0
+		);
+
+		assert(el);
+	}
+
+	register_ev(&exact, 101, 0);
+
+	n_fired = chron_timer_wheel_advance(tw, 1000);
+	assert(n_fired == N + 1);
+
+	for (int i = 0; i < N; i++) {
+		assert(evs[i].n_fired == 1);
+		assert(evs[i].fired_at[0] == evs[0].fired_at[0]);
+		assert(evs[i].fired_at[0] >= (uint64_t)windows[i][0]);
+		assert(evs[i].fired_at[0] <= (uint64_t)(windows[i][0] + windows[i][1]));
+	}
+
+	assert(exact.fired_at[0] == 101);
+
+	teardown();
+}
+
+/**
+ * Batched events due at the same tick are delivered in a single call of
+ * their batch callback
+ */
+static void test_batch(chron_tw_backend backend) {
+	static const int intervals[] = { 5, 5, 6, 5 };
+	enum { N = sizeof(intervals) / sizeof(intervals[0]) };
+	test_ev_t evs[N] = { 0 };
+	test_ev_t single = { 0 };
+	uint64_t n_fired;
+
+	setup(backend);
+
+	for (int i = 0; i < N; i++) {
+		chron_tw_slot_el_t* el = chron_timer_wheel_register_ev_batched(
+			tw,
+			on_batch,
+			&evs[i],
+			sizeof(test_ev_t),
+			intervals[i],
+			0
+		);
+
+		assert(el);
+	}
+
+	register_ev(&single, 5, 0);
+
+	n_fired = chron_timer_wheel_advance(tw, 10);
+	assert(n_fired == N + 1);
+
+	assert(n_batches == 2);
+	assert(batch_sizes[0] == 3 && batch_sizes[1] == 1);
+
+	for (int i = 0; i < N; i++) {
+		assert(evs[i].n_fired == 1 && evs[i].fired_at[0] == (uint64_t)intervals[i]);
+	}
+
+	assert(single.n_fired == 1 && single.fired_at[0] == 5);
+
+	teardown();
+}
+
+/**
+ * Events unregistered in a batch never fire, including one with a reschedule
+ * still pending and one listed twice; the rest of the wheel is unaffected
+ */
+static void test_unregister_batch(chron_tw_backend backend) {
+	enum { N = 8 };
+	test_ev_t evs[N] = { 0 };
+	test_ev_t kept = { 0 };
+	chron_tw_slot_el_t* els[N + 1];
+	chron_tw_stats_t stats;
+	uint64_t n_fired;
+
+	setup(backend);
+
+	for (int i = 0; i < N; i++) els[i] = register_ev(&evs[i], 10 + i * 100, i % 2);
+
+	register_ev(&kept, 50, 0);
+
+	chron_timer_wheel_advance(tw, 5);
+
+	chron_timer_wheel_reschedule_ev(tw, els[0], 1);
+	els[N] = els[1];
+
+	chron_timer_wheel_unregister_batch(tw, els, N + 1);
+
+	chron_timer_wheel_get_stats(tw, &stats);
+	assert(stats.n_cancelled == N);
+
+	n_fired = chron_timer_wheel_advance(tw, 5000);
+	assert(n_fired == 1);
+	assert(kept.n_fired == 1 && kept.fired_at[0] == 50);
+
+	for (int i = 0; i < N; i++) assert(evs[i].n_fired == 0);
+
+	teardown();
+}
+
+/**
+ * Resetting the clock keeps every event's remaining ticks, including those
+ * of a registration and a reschedule still queued; a started wheel refuses
+ */
+static void test_reset(chron_tw_backend backend) {
+	test_ev_t placed = { 0 };
+	test_ev_t queued = { 0 };
+	test_ev_t moved = { 0 };
+	chron_tw_slot_el_t* moved_el;
+	chron_tw_opts_t opts = { .size = TEST_SIZE, .tick_interval = 1, .is_pollable = true, .backend = backend };
+	chron_timer_wheel_t* started;
+
+	setup(backend);
+
+	register_ev(&placed, 100, 0);
+	moved_el = register_ev(&moved, 1000, 0);
+
+	chron_timer_wheel_advance(tw, 50);
+
+	register_ev(&queued, 30, 0);
+	chron_timer_wheel_reschedule_ev(tw, moved_el, 70);
+
+	assert(chron_timer_wheel_reset(tw));
+	assert(atomic_load(&tw->abs_tick) == 0);
+
+	chron_timer_wheel_advance(tw, 1000);
+
+	assert(placed.n_fired == 1 && placed.fired_at[0] == 50);
+	assert(queued.n_fired == 1 && queued.fired_at[0] == 30);
+	assert(moved.n_fired == 1 && moved.fired_at[0] == 70);
+
+	teardown();
+
+	started = chron_timer_wheel_init_opts(&opts);
+	assert(started);
+
+	if (!chron_timer_wheel_start(started)) abort();
+
+	assert(!chron_timer_wheel_reset(started));
+
+	chron_timer_wheel_destroy(started);
+}
+
+/**
+ * The time remaining counts down to a one-shot event's deadline, and is no
+ * longer reported once the event has fired, until it is rescheduled
+ */
+static void test_remaining(chron_tw_backend backend) {
+	test_ev_t once = { 0 };
+	test_ev_t periodic = { 0 };
+	chron_tw_slot_el_t* once_el;
+	chron_tw_slot_el_t* periodic_el;
+
+	setup(backend);
+
+	once_el = register_ev(&once, 10, 0);
+	periodic_el = register_ev(&periodic, 10, 1);
+
+	chron_timer_wheel_advance(tw, 4);
+	assert(chron_timer_wheel_get_time_remaining(tw, once_el) == 6);
+
+	chron_timer_wheel_advance(tw, 6);
+	assert(once.n_fired == 1 && periodic.n_fired == 1);
+	assert(chron_timer_wheel_get_time_remaining(tw, once_el) == -1);
+	assert(chron_timer_wheel_get_ns_remaining(tw, once_el) == -1);
+	assert(chron_timer_wheel_get_time_remaining(tw, periodic_el) == 10);
+
+	chron_timer_wheel_reschedule_ev(tw, once_el, 5);
+	assert(chron_timer_wheel_get_time_remaining(tw, once_el) == 5);
+
+	chron_timer_wheel_advance(tw, 5);
+	assert(once.n_fired == 2 && once.fired_at[1] == 15);
+	assert(chron_timer_wheel_get_time_remaining(tw, once_el) == -1);
+
+	teardown();
+}
+
+/**
+ * An event due at the tick being processed, whose reschedule to a later tick
+ * is still queued, fires only at its new deadline
+ */
+static void test_reschedule_pending(chron_tw_backend backend) {
+	test_ev_t first = { 0 };
+	test_ev_t deferred = { 0 };
+	chron_tw_slot_el_t* el;
+
+	setup(backend);
+
+	el = chron_timer_wheel_register_ev(tw, on_defer_expiry, &first, sizeof(test_ev_t), 10, 0);
+	assert(el);
+
+	deferred_el = register_ev(&deferred, 10, 0);
+
+	chron_timer_wheel_advance(tw, 100);
+
+	assert(first.n_fired == 1 && first.fired_at[0] == 10);
+	assert(deferred.n_fired == 1 && deferred.fired_at[0] == 30);
+
+	teardown();
+}
+
+int main(int argc, char* argv[]) {
+	static const chron_tw_backend backends[] = {
+		TW_BACKEND_WHEEL,
+		TW_BACKEND_HEAP,
+		TW_BACKEND_ARRAY
+	};
+
+	(void)argc;
+	(void)argv;
+
+	for (int i = 0; i < (int)(sizeof(backends) / sizeof(backends[0])); i++) {
+		test_levels(backends[i]);
+		test_cascade(backends[i]);
+		test_recurring(backends[i]);
+		test_reschedule_unregister(backends[i]);
+		test_slack(backends[i]);
+		test_batch(backends[i]);
+		test_unregister_batch(backends[i]);
+		test_reset(backends[i]);
+		test_remaining(backends[i]);
+		test_reschedule_pending(backends[i]);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,166 @@
+#include "libchron.h"
+
+#include <assert.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Tests of a pollable chron_timer_wheel_t, driven by a poll loop on the wheel's
+ * file descriptor: the fd becomes readable only once an event is due, every
+ * callback runs on the thread calling chron_timer_wheel_process, and an event
+ * registered from another thread wakes the loop.
+ */
+
+typedef struct test_ev {
+	int n_fired;
+
+	/* set if the callback ran on a thread other than the loop's */
+	bool is_foreign;
+} test_ev_t;
+
+static pthread_t loop_thread;
+
+static chron_timer_wheel_t* tw;
+
+static uint64_t now_ms(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / CHRON_NS_PER_MS;
+}
+
+static void on_expiry(void* arg, int arg_size) {
+	test_ev_t* ev = arg;
+
+	assert(arg_size == sizeof(test_ev_t));
+
+	if (!pthread_equal(pthread_self(), loop_thread)) ev->is_foreign = true;
+
+	ev->n_fired++;
+}
+
+static void* registrar(void* arg) {
+	usleep(20000);
+
+	if (!chron_timer_wheel_register_ev(tw, on_expiry, arg, sizeof(test_ev_t), 5, 0)) abort();
+
+	return NULL;
+}
+
+/**
+ * Wait for the wheel's fd to become readable, for at most `timeout_ms`
+ *
+ * @return bool whether it became readable
+ */
+static bool wait_readable(int timeout_ms) {
+	struct pollfd pfd = { .fd = chron_timer_wheel_get_fd(tw), .events = POLLIN };
+
+	return poll(&pfd, 1, timeout_ms) == 1 && (pfd.revents & POLLIN);
+}
+
+static void setup(void) {
+	chron_tw_opts_t opts = {
+		.size = 64,
+		.tick_interval = 1,
+		.resolution_ns = CHRON_NS_PER_MS,
+		.is_pollable = true
+	};
+
+	loop_thread = pthread_self();
+
+	tw = chron_timer_wheel_init_opts(&opts);
+	assert(tw);
+
+	assert(chron_timer_wheel_get_fd(tw) >= 0);
+
+	// nothing is processed before the wheel is started
+	assert(chron_timer_wheel_process(tw) == 0);
+
+	if (!chron_timer_wheel_start(tw)) abort();
+}
+
+/**
+ * Only a pollable wheel has an fd, and only a pollable wheel is processed
+ */
+static void test_not_pollable(void) {
+	chron_tw_opts_t opts = { .size = 64, .tick_interval = 1, .is_manual = true };
+	chron_timer_wheel_t* manual = chron_timer_wheel_init_opts(&opts);
+
+	assert(manual);
+
+	assert(chron_timer_wheel_get_fd(manual) == -1);
+	assert(chron_timer_wheel_process(manual) == 0);
+
+	chron_timer_wheel_destroy(manual);
+}
+
+/**
+ * The fd stays unreadable until the first event is due; one-shot and recurring
+ * events then fire on the loop's thread, each when due
+ */
+static void test_loop(void) {
+	test_ev_t once = { 0 };
+	test_ev_t recurring = { 0 };
+	uint64_t start_ms;
+	uint64_t n_fired = 0;
+
+	setup();
+
+	start_ms = now_ms();
+
+	if (!chron_timer_wheel_register_ev(tw, on_expiry, &once, sizeof(test_ev_t), 30, 0)) abort();
+	if (!chron_timer_wheel_register_ev(tw, on_expiry, &recurring, sizeof(test_ev_t), 20, 1)) abort();
+
+	assert(!wait_readable(10));
+
+	while (now_ms() - start_ms < 110) {
+		if (wait_readable(10)) n_fired += chron_timer_wheel_process(tw);
+	}
+
+	assert(once.n_fired == 1);
+	assert(recurring.n_fired >= 3 && recurring.n_fired <= 5);
+	assert(n_fired == (uint64_t)(once.n_fired + recurring.n_fired));
+	assert(!once.is_foreign && !recurring.is_foreign);
+
+	chron_timer_wheel_destroy(tw);
+}
+
+/**
+ * An event registered from another thread while the loop waits on an idle
+ * wheel re-arms the fd, and fires on the loop's thread
+ */
+static void test_foreign_register(void) {
+	test_ev_t ev = { 0 };
+	pthread_t thread;
+	uint64_t start_ms;
+
+	setup();
+
+	if (pthread_create(&thread, NULL, registrar, &ev)) abort();
+
+	start_ms = now_ms();
+
+	assert(wait_readable(1000));
+	assert(now_ms() - start_ms < 500);
+
+	pthread_join(thread, NULL);
+
+	assert(chron_timer_wheel_process(tw) == 1);
+	assert(ev.n_fired == 1 && !ev.is_foreign);
+
+	chron_timer_wheel_destroy(tw);
+}
+
+int main(int argc, char* argv[]) {
+	(void)argc;
+	(void)argv;
+
+	test_not_pollable();
+	test_loop();
+	test_foreign_register();
+
+	return EXIT_SUCCESS;
+}
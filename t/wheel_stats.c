@@ -0,0 +1,71 @@
+#include "libchron.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * Tests of chron_timer_wheel_get_stats on a running wheel, whose thread a
+ * slow callback holds up past the ticks that come due after it.
+ */
+
+/* how long the slow callback holds the wheel thread, in ms */
+#define TEST_STALL_MS 50
+
+static atomic_int n_fired;
+
+static void on_slow_expiry(void* arg, int arg_size) {
+	(void)arg;
+	(void)arg_size;
+
+	usleep(TEST_STALL_MS * 1000);
+
+	atomic_fetch_add(&n_fired, 1);
+}
+
+static void on_expiry(void* arg, int arg_size) {
+	(void)arg;
+	(void)arg_size;
+
+	atomic_fetch_add(&n_fired, 1);
+}
+
+/**
+ * A tick processed late counts every tick it was late by, not just one
+ */
+static void test_ticks_missed(void) {
+	chron_tw_opts_t opts = {
+		.size = 64,
+		.tick_interval = 1,
+		.resolution_ns = CHRON_NS_PER_MS
+	};
+	chron_timer_wheel_t* tw;
+	chron_tw_stats_t stats;
+	int arg = 0;
+
+	tw = chron_timer_wheel_init_opts(&opts);
+	assert(tw);
+
+	if (!chron_timer_wheel_start(tw)) abort();
+
+	if (!chron_timer_wheel_register_ev(tw, on_slow_expiry, &arg, sizeof(arg), 1, 0)) abort();
+	if (!chron_timer_wheel_register_ev(tw, on_expiry, &arg, sizeof(arg), 2, 0)) abort();
+
+	for (int i = 0; i < 1000 && atomic_load(&n_fired) < 2; i++) usleep(1000);
+
+	assert(atomic_load(&n_fired) == 2);
+
+	chron_timer_wheel_get_stats(tw, &stats);
+	assert(stats.n_ticks_missed >= TEST_STALL_MS / 2);
+
+	chron_timer_wheel_destroy(tw);
+}
+
+int main(int argc, char* argv[]) {
+	(void)argc;
+	(void)argv;
+
+	test_ticks_missed();
+
+	return EXIT_SUCCESS;
+}
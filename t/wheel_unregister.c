@@ -0,0 +1,260 @@
+#include "libchron.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Several producer threads register events on a running wheel and unregister
+ * them while they fire, one at a time or in batches. Once an unregister
+ * returns, the event's callback must be neither running nor ever invoked
+ * again. Run with callbacks inline on the wheel thread, and on a pool of
+ * workers. Then, an unregister waiting on a long callback must sleep rather than spin, and two
+ * callbacks unregistering each other's events must not deadlock.
+ */
+
+#define TEST_N_PRODUCERS 4
+
+/* events registered by each producer at a time */
+#define TEST_N_EVENTS 64
+
+#define TEST_N_ROUNDS 50
+
+/* how long a slow callback holds its event, in us */
+#define TEST_SLOW_US 100000
+
+typedef struct test_ev {
+	/* callbacks of the event currently running */
+	atomic_int n_running;
+
+	/* set once the event's unregister has returned */
+	atomic_bool is_unregistered;
+} test_ev_t;
+
+static chron_timer_wheel_t* tw;
+
+/* callbacks invoked after their event was unregistered */
+static atomic_long n_late;
+
+static atomic_long n_fired;
+
+/* set once the slow callback is running */
+static atomic_bool is_slow_running;
+
+/* callbacks of the mutually unregistering events that have started, and finished */
+static atomic_int n_mutual_started;
+
+static atomic_int n_mutual_done;
+
+static void on_expiry(void* arg, int arg_size) {
+	test_ev_t* ev = arg;
+
+	(void)arg_size;
+
+	atomic_fetch_add(&ev->n_running, 1);
+
+	if (atomic_load(&ev->is_unregistered)) atomic_fetch_add(&n_late, 1);
+
+	// widen the window in which an unregister overlaps the callback
+	usleep(20);
+
+	if (atomic_load(&ev->is_unregistered)) atomic_fetch_add(&n_late, 1);
+
+	atomic_fetch_sub(&ev->n_running, 1);
+	atomic_fetch_add(&n_fired, 1);
+}
+
+static void on_slow_expiry(void* arg, int arg_size) {
+	(void)arg;
+	(void)arg_size;
+
+	atomic_store(&is_slow_running, true);
+
+	usleep(TEST_SLOW_US);
+}
+
+static void on_mutual_expiry(void* arg, int arg_size) {
+	_Atomic(chron_tw_slot_el_t*)* other = arg;
+	chron_tw_slot_el_t* el;
+
+	(void)arg_size;
+
+	atomic_fetch_add(&n_mutual_started, 1);
+
+	// give the other callback the time to be running too
+	for (int i = 0; i < 1000 && atomic_load(&n_mutual_started) < 2; i++) usleep(100);
+
+	while (!(el = atomic_load(other))) usleep(100);
+
+	chron_timer_wheel_unregister_ev(tw, el);
+
+	atomic_fetch_add(&n_mutual_done, 1);
+}
+
+static void* producer(void* arg) {
+	unsigned int seed = (unsigned int)(uintptr_t)arg;
+	chron_tw_slot_el_t* els[TEST_N_EVENTS];
+	test_ev_t* evs = calloc(TEST_N_ROUNDS * TEST_N_EVENTS, sizeof(test_ev_t));
+
+	assert(evs);
+
+	for (int round = 0; round < TEST_N_ROUNDS; round++) {
+		test_ev_t* round_evs = &evs[round * TEST_N_EVENTS];
+
+		for (int i = 0; i < TEST_N_EVENTS; i++) {
+			els[i] = chron_timer_wheel_register_ev(
+				tw,
+				on_expiry,
+				&round_evs[i],
+				sizeof(test_ev_t),
+				1 + rand_r(&seed) % 4,
+				i % 2
+			);
+
+			assert(els[i]);
+		}
+
+		usleep(rand_r(&seed) % 5000);
+
+		// every other round unregisters its events in a single batch
+		if (round % 2) chron_timer_wheel_unregister_batch(tw, els, TEST_N_EVENTS);
+
+		for (int i = 0; i < TEST_N_EVENTS; i++) {
+			if (!(round % 2)) chron_timer_wheel_unregister_ev(tw, els[i]);
+
+			assert(atomic_load(&round_evs[i].n_running) == 0);
+			atomic_store(&round_evs[i].is_unregistered, true);
+		}
+	}
+
+	// give callbacks invoked late the time to find their event unregistered
+	usleep(20000);
+
+	return evs;
+}
+
+static void run(int n_workers) {
+	chron_tw_opts_t opts = {
+		.size = 64,
+		.tick_interval = 1,
+		.resolution_ns = CHRON_NS_PER_MS,
+		.n_workers = n_workers
+	};
+	pthread_t producers[TEST_N_PRODUCERS];
+	void* evs[TEST_N_PRODUCERS];
+
+	n_late = 0;
+	n_fired = 0;
+
+	tw = chron_timer_wheel_init_opts(&opts);
+	assert(tw);
+
+	if (!chron_timer_wheel_start(tw)) abort();
+
+	for (int i = 0; i < TEST_N_PRODUCERS; i++) {
+		if (pthread_create(&producers[i], NULL, producer, (void*)(uintptr_t)(i + 1))) abort();
+	}
+
+	for (int i = 0; i < TEST_N_PRODUCERS; i++) pthread_join(producers[i], &evs[i]);
+
+	chron_timer_wheel_destroy(tw);
+
+	for (int i = 0; i < TEST_N_PRODUCERS; i++) free(evs[i]);
+
+	assert(atomic_load(&n_fired) > 0);
+	assert(atomic_load(&n_late) == 0);
+}
+
+static uint64_t thread_cpu_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+	return (uint64_t)ts.tv_sec * CHRON_NS_PER_S + ts.tv_nsec;
+}
+
+/**
+ * An unregister that waits for a long callback to return sleeps until it does
+ */
+static void test_wait_sleeps(void) {
+	chron_tw_opts_t opts = {
+		.size = 64,
+		.tick_interval = 1,
+		.resolution_ns = CHRON_NS_PER_MS
+	};
+	chron_tw_slot_el_t* el;
+	uint64_t cpu_ns;
+	int arg = 0;
+
+	is_slow_running = false;
+
+	tw = chron_timer_wheel_init_opts(&opts);
+	assert(tw);
+
+	if (!chron_timer_wheel_start(tw)) abort();
+
+	el = chron_timer_wheel_register_ev(tw, on_slow_expiry, &arg, sizeof(arg), 1, 0);
+	assert(el);
+
+	while (!atomic_load(&is_slow_running)) usleep(100);
+
+	cpu_ns = thread_cpu_ns();
+	chron_timer_wheel_unregister_ev(tw, el);
+	cpu_ns = thread_cpu_ns() - cpu_ns;
+
+	assert(cpu_ns < TEST_SLOW_US * 1000 / 10);
+
+	chron_timer_wheel_destroy(tw);
+}
+
+/**
+ * Two callbacks running at once on different workers, each unregistering the
+ * other's event, both return
+ */
+static void test_mutual(void) {
+	chron_tw_opts_t opts = {
+		.size = 64,
+		.tick_interval = 1,
+		.resolution_ns = CHRON_NS_PER_MS,
+		.n_workers = 2
+	};
+	_Atomic(chron_tw_slot_el_t*) others[2] = { NULL, NULL };
+	chron_tw_slot_el_t* els[2];
+
+	n_mutual_started = 0;
+	n_mutual_done = 0;
+
+	tw = chron_timer_wheel_init_opts(&opts);
+	assert(tw);
+
+	if (!chron_timer_wheel_start(tw)) abort();
+
+	// each event is handed the other's handle, and lands on its own worker
+	for (int i = 0; i < 2; i++) {
+		els[i] = chron_timer_wheel_register_ev(tw, on_mutual_expiry, &others[i], sizeof(others[i]), 5, 0);
+		assert(els[i]);
+	}
+
+	atomic_store(&others[0], els[1]);
+	atomic_store(&others[1], els[0]);
+
+	for (int i = 0; i < 2000 && atomic_load(&n_mutual_done) < 2; i++) usleep(1000);
+
+	assert(atomic_load(&n_mutual_done) == 2);
+
+	chron_timer_wheel_destroy(tw);
+}
+
+int main(int argc, char* argv[]) {
+	(void)argc;
+	(void)argv;
+
+	run(0);
+	run(4);
+
+	test_wait_sleeps();
+	test_mutual();
+
+	return EXIT_SUCCESS;
+}